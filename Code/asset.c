@@ -0,0 +1,55 @@
+#include "types.h"
+#include "asset.h"
+
+static const struct asset_archive *archive;
+
+static bool name_eq(const char *a, const char *b, u32 n){
+	for (; n && *a == *b; n--, a++, b++)
+		if (!*a)
+			return true;
+	return !n;
+}
+
+bool assets_open(const struct asset_archive *a, u32 size){
+	if (((uptr) a & (ASSET_ALIGN - 1)) || size < sizeof(*a))
+		return false;
+	if (a->magic != ASSET_MAGIC || a->version != ASSET_VERSION || a->size > size)
+		return false;
+	if (sizeof(*a) + a->count * sizeof(a->entry[0]) > a->size)
+		return false;
+	if (asset_sum(a->entry, a->count * sizeof(a->entry[0])) != a->sum)
+		return false;
+
+	for (u32 i = 0; i < a->count; i++){
+		const struct asset_entry *e = &a->entry[i];
+		if ((e->offset & (ASSET_ALIGN - 1)) || e->offset > a->size || e->size > a->size - e->offset)
+			return false;
+		if (e->name[ASSET_NAME - 1] || asset_sum((const u8 *) a + e->offset, e->size) != e->sum)
+			return false;
+	}
+	archive = a;
+	return true;
+}
+
+const void *asset_get(const char *name, u32 *size){
+	if (!archive)
+		return 0;
+	for (u32 i = 0; i < archive->count; i++)
+		if (name_eq(archive->entry[i].name, name, ASSET_NAME)){
+			*size = archive->entry[i].size;
+			return (const u8 *) archive + archive->entry[i].offset;
+		}
+	return 0;
+}
+
+/* Todas las cadenas tienen que terminar dentro de la tabla */
+bool strings_valid(const struct string_table *t, u32 size){
+	if (size < sizeof(*t) || t->count < STR_COUNT)
+		return false;
+	if (sizeof(*t) + t->count * sizeof(t->offset[0]) > size || ((const char *) t)[size - 1])
+		return false;
+	for (u32 i = 0; i < t->count; i++)
+		if (t->offset[i] >= size)
+			return false;
+	return true;
+}
@@ -0,0 +1,112 @@
+#ifndef ASSET_H
+#define ASSET_H
+
+#include "types.h"
+
+/* Archivo de recursos: niveles, sprites y textos que antes estaban escritos en
+   kernel.c. Lo arma pack.c al compilar, GRUB lo carga como modulo y el kernel
+   usa cada registro en la memoria donde quedo, sin copiarlo ni convertirlo.
+   Las sumas se revisan una sola vez al arrancar.
+
+   Cabecera | indice (count entradas) | registros alineados a ASSET_ALIGN */
+
+#define ASSET_MAGIC   (0x54455341) // "ASET"
+#define ASSET_VERSION (1)
+#define ASSET_ALIGN   (16)
+#define ASSET_NAME    (12)
+
+struct asset_entry{
+	char name[ASSET_NAME];	// terminado en 0
+	u32 offset;		// desde el inicio del archivo, multiplo de ASSET_ALIGN
+	u32 size;		// bytes del registro
+	u32 sum;		// asset_sum() del registro
+};
+
+struct asset_archive{
+	u32 magic;
+	u16 version;
+	u16 count;
+	u32 size;		// bytes del archivo completo
+	u32 sum;		// asset_sum() del indice
+	struct asset_entry entry[];
+};
+
+_Static_assert(sizeof(struct asset_entry) == 24, "struct asset_entry no coincide con pack.c");
+_Static_assert(sizeof(struct asset_archive) == 16, "struct asset_archive no coincide con pack.c");
+
+/* FNV-1a de 32 bits */
+static inline u32 asset_sum(const void *p, u32 n){
+	const u8 *b = p;
+	u32 h = 0x811C9DC5;
+	while (n--)
+		h = (h ^ *b++) * 0x01000193;
+	return h;
+}
+
+/* Archivo incluido en el kernel (assets.S), el mismo que va en la ISO */
+extern const struct asset_archive builtin_assets;
+
+/* Revisa cabecera, indice y sumas de un archivo de size bytes y, si esta bien,
+   lo deja como el archivo del que sale asset_get() */
+bool assets_open(const struct asset_archive *a, u32 size);
+
+/* Direccion de un registro dentro del archivo abierto, o 0 si no esta */
+const void *asset_get(const char *name, u32 *size);
+
+/* Formatos de los registros (los niveles estan en level.h) */
+
+/* "sprites": arreglo de struct sprite. Los numeros de color corresponden a
+   "enum color" de kernel.c; 0 es una celda vacia */
+#define SPRITE_FILL (1) // el color de la celda va de fondo (jugador)
+
+struct sprite{
+	u8 w, h;	// celdas
+	u8 mode;	// SPRITE_FILL o 0 (el color va en el caracter)
+	u8 ink;		// color del caracter si SPRITE_FILL, o bits que se le suman
+	char glyph[2];	// caracter de cada fila
+	u8 color[2][3];
+};
+
+_Static_assert(sizeof(struct sprite) == 12, "struct sprite no coincide con sprites.S");
+
+/* "strings": tabla de cadenas terminadas en 0. Los indices son fijos (text.S) */
+enum string_id{
+	STR_BOX,	// borde del titulo
+	STR_SIDE,
+	STR_TITLE,
+	STR_SCHOOL,
+	STR_COURSE,
+	STR_AUTHOR,
+	STR_TEACHER,
+	STR_ENTER,
+	STR_GAMEOVER,
+	STR_LEVEL,
+	STR_WIN,
+	STR_SCORE,
+	STR_LIVES,
+	STR_BEST,	// titulo de la tabla de records
+	STR_COUNT
+};
+
+struct string_table{
+	u16 count;
+	u16 offset[];	// desde el inicio de la tabla hasta cada cadena
+};
+
+static inline const char *string_get(const struct string_table *t, u32 id){
+	return (const char *) t + t->offset[id];
+}
+
+bool strings_valid(const struct string_table *t, u32 size);
+
+/* "about": textos de la portada, cada uno una cadena de "strings" en x, y */
+struct text_item{
+	u8 x, y;
+	u8 fg, bg;
+	u16 str;
+	u16 pad;
+};
+
+_Static_assert(sizeof(struct text_item) == 8, "struct text_item no coincide con text.S");
+
+#endif
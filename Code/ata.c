@@ -0,0 +1,136 @@
+#include "types.h"
+#include "io.h"
+#include "clock.h"
+#include "ata.h"
+
+#define ATA_BASE (0x1F0)
+#define ATA_CTRL (0x3F6)
+
+/* Registros desde ATA_BASE */
+#define REG_DATA    (0)
+#define REG_COUNT   (2)
+#define REG_LBA0    (3)
+#define REG_LBA1    (4)
+#define REG_LBA2    (5)
+#define REG_DRIVE   (6)
+#define REG_STATUS  (7)	// al leer
+#define REG_COMMAND (7)	// al escribir
+
+#define ST_ERR (1 << 0)
+#define ST_DRQ (1 << 3)
+#define ST_DF  (1 << 5)
+#define ST_BSY (1 << 7)
+
+#define CMD_READ     (0x20)
+#define CMD_WRITE    (0x30)
+#define CMD_FLUSH    (0xE7)
+#define CMD_IDENTIFY (0xEC)
+
+/* Lo que puede tardar el disco en una operacion antes de darla por fallida */
+#define ATA_TIMEOUT (1000)	// ms
+
+void (*ata_idle)(void);
+
+static bool present;
+static u32 sectors;
+
+/* Espera a que el disco no este ocupado y, si want, a que pida o entregue
+   datos. Retorna false si hubo error o se acabo el tiempo */
+static bool wait(bool want){
+	u64 deadline = rdtsc() + ms_ticks(ATA_TIMEOUT);
+	while (true){
+		u8 s = inb(ATA_BASE + REG_STATUS);
+		if (!(s & ST_BSY)){
+			if (s & (ST_ERR | ST_DF))
+				return false;
+			if (!want || (s & ST_DRQ))
+				return true;
+		}
+		if (rdtsc() > deadline)
+			return false;
+		if (ata_idle)
+			ata_idle();
+		else
+			cpu_relax();
+	}
+}
+
+/* Leer el registro de control cuatro veces da los 400 ns que pide el disco
+   despues de elegir unidad o mandar un comando */
+static void delay400(void){
+	for (u32 i = 0; i < 4; i++)
+		inb(ATA_CTRL);
+}
+
+static void command(u32 lba, u8 cmd){
+	outb(ATA_BASE + REG_DRIVE, 0xE0 | ((lba >> 24) & 0x0F));
+	delay400();
+	outb(ATA_BASE + REG_COUNT, 1);
+	outb(ATA_BASE + REG_LBA0, lba);
+	outb(ATA_BASE + REG_LBA1, lba >> 8);
+	outb(ATA_BASE + REG_LBA2, lba >> 16);
+	outb(ATA_BASE + REG_COMMAND, cmd);
+	delay400();
+}
+
+bool ata_init(void){
+	u16 id[ATA_SECTOR / 2];
+
+	outb(ATA_CTRL, 0x02);	// sin interrupciones
+	outb(ATA_BASE + REG_DRIVE, 0xA0);
+	delay400();
+	outb(ATA_BASE + REG_COUNT, 0);
+	outb(ATA_BASE + REG_LBA0, 0);
+	outb(ATA_BASE + REG_LBA1, 0);
+	outb(ATA_BASE + REG_LBA2, 0);
+	outb(ATA_BASE + REG_COMMAND, CMD_IDENTIFY);
+	delay400();
+
+	/* Sin disco el bus flota en 0xFF o el estado queda en 0; con un ATAPI
+	   (CD) LBA1/LBA2 traen su firma */
+	u8 s = inb(ATA_BASE + REG_STATUS);
+	if (s == 0 || s == 0xFF)
+		return false;
+	if (!wait(false) || inb(ATA_BASE + REG_LBA1) || inb(ATA_BASE + REG_LBA2))
+		return false;
+	if (!wait(true))
+		return false;
+	for (u32 i = 0; i < ATA_SECTOR / 2; i++)
+		id[i] = inw(ATA_BASE + REG_DATA);
+
+	sectors = id[60] | (u32) id[61] << 16;	// sectores con LBA de 28 bits
+	present = sectors != 0;
+	return present;
+}
+
+u32 ata_sectors(void){
+	return present ? sectors : 0;
+}
+
+bool ata_read(u32 lba, void *buf){
+	u16 *p = buf;
+	if (!present || lba >= sectors || !wait(false))
+		return false;
+	command(lba, CMD_READ);
+	if (!wait(true))
+		return false;
+	for (u32 i = 0; i < ATA_SECTOR / 2; i++)
+		p[i] = inw(ATA_BASE + REG_DATA);
+	return true;
+}
+
+bool ata_write(u32 lba, const void *buf){
+	const u16 *p = buf;
+	if (!present || lba >= sectors || !wait(false))
+		return false;
+	command(lba, CMD_WRITE);
+	if (!wait(true))
+		return false;
+	for (u32 i = 0; i < ATA_SECTOR / 2; i++)
+		outw(ATA_BASE + REG_DATA, p[i]);
+	if (!wait(false))
+		return false;
+	outb(ATA_BASE + REG_COMMAND, CMD_FLUSH);
+	delay400();
+	return wait(false);
+}
@@ -0,0 +1,29 @@
+#ifndef ATA_H
+#define ATA_H
+
+#include "types.h"
+
+/* Disco ATA maestro del canal primario (el -hda de QEMU) por PIO con LBA de
+   28 bits y sin interrupciones: se pregunta el estado del controlador. Cada
+   operacion es de un sector */
+
+#define ATA_SECTOR (512)
+
+/* Mientras el disco esta ocupado se llama ata_idle si no es 0 (la tarea que
+   escribe cede el procesador) y si no se espera activamente */
+extern void (*ata_idle)(void);
+
+/* Busca el disco con IDENTIFY; retorna false si no hay o no es ATA. Las
+   demas funciones fallan sin tocar el hardware si no se encontro */
+bool ata_init(void);
+
+/* Cantidad de sectores del disco (0 si no hay) */
+u32 ata_sectors(void);
+
+bool ata_read(u32 lba, void *buf);
+
+/* Escribe y vacia la cache del disco, asi al retornar true el sector ya
+   quedo guardado */
+bool ata_write(u32 lba, const void *buf);
+
+#endif
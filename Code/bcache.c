@@ -0,0 +1,99 @@
+#include "types.h"
+#include "mem.h"
+#include "ata.h"
+#include "bcache.h"
+
+static struct{
+	u32 lba;
+	bool valid, dirty;
+	bool busy;	// alguien esta usando el disco para este bloque
+	u32 used;	// para sacar el que se uso hace mas tiempo
+	u8 data[ATA_SECTOR];
+} block[BCACHE_BLOCKS];
+
+static u32 tick;
+
+/* El disco esta en medio de una operacion. Quien la hace cede el procesador
+   mientras espera (ata_idle), y otra tarea no puede mandar un comando hasta
+   que termine */
+static bool disk_busy(void){
+	for (u32 i = 0; i < BCACHE_BLOCKS; i++)
+		if (block[i].busy)
+			return true;
+	return false;
+}
+
+/* El bloque de lba o, si no esta, el limpio que se uso hace mas tiempo
+   (vaciado). Los sucios solo salen cuando la tarea de disco los baja, y los
+   ocupados no se tocan; retorna -1 si no queda ninguno libre */
+static s32 lookup(u32 lba, bool *hit){
+	s32 victim = -1;
+	for (u32 i = 0; i < BCACHE_BLOCKS; i++){
+		if (block[i].valid && block[i].lba == lba){
+			*hit = true;
+			block[i].used = ++tick;
+			return i;
+		}
+		if (block[i].busy || (block[i].valid && block[i].dirty))
+			continue;
+		if (victim < 0 || !block[i].valid || block[i].used < block[victim].used)
+			victim = i;
+	}
+	*hit = false;
+	if (victim >= 0){
+		block[victim].valid = block[victim].dirty = false;
+		block[victim].used = ++tick;
+	}
+	return victim;
+}
+
+const u8 *bcache_read(u32 lba){
+	bool hit;
+	s32 i = lookup(lba, &hit);
+	if (hit)
+		return block[i].data;
+	if (i < 0 || disk_busy())
+		return 0;
+	block[i].busy = true;
+	bool ok = ata_read(lba, block[i].data);
+	block[i].busy = false;
+	if (!ok)
+		return 0;
+	block[i].lba = lba;
+	block[i].valid = true;
+	return block[i].data;
+}
+
+bool bcache_write(u32 lba, const void *data){
+	bool hit;
+	s32 i = lookup(lba, &hit);
+	if (i < 0)
+		return false;
+	memcpy(block[i].data, data, ATA_SECTOR);
+	block[i].lba = lba;
+	block[i].valid = block[i].dirty = true;
+	return true;
+}
+
+/* Se escribe una copia: mientras el disco trabaja la tarea cede el procesador
+   y alguien puede volver a escribir el mismo sector, que entonces queda sucio
+   otra vez y se baja en la siguiente vuelta. El bloque queda ocupado hasta
+   terminar para que nadie lo reuse con otro sector */
+bool bcache_flush(void){
+	static u8 copy[ATA_SECTOR];
+	if (disk_busy())
+		return false;
+	for (u32 i = 0; i < BCACHE_BLOCKS; i++){
+		if (!block[i].valid || !block[i].dirty)
+			continue;
+		memcpy(copy, block[i].data, ATA_SECTOR);
+		block[i].dirty = false;
+		block[i].busy = true;
+		bool ok = ata_write(block[i].lba, copy);
+		if (!ok)
+			block[i].dirty = true;	// queda solo en el cache; se reintenta
+		block[i].busy = false;
+		return ok;
+	}
+	return false;
+}
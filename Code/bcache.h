@@ -0,0 +1,30 @@
+#ifndef BCACHE_H
+#define BCACHE_H
+
+#include "types.h"
+#include "ata.h"
+
+/* Cache de sectores del disco con escritura diferida. Escribir solo copia al
+   cache y lo marca sucio; la tarea de disco lo baja con bcache_flush() cuando
+   le toca, asi quien escribe (la simulacion) nunca espera al disco. Leer un
+   sector que ya esta en el cache no toca el disco, y el arranque lee una vez
+   lo que se va a usar. Todo corre en el mismo nucleo, sin candados: el
+   bloque con el que se esta usando el disco queda ocupado y mientras tanto
+   nadie mas le manda comandos */
+
+#define BCACHE_BLOCKS (4)
+
+/* El sector lba (leyendolo si no esta); 0 si no se pudo leer o si el disco
+   estaba ocupado */
+const u8 *bcache_read(u32 lba);
+
+/* Reemplaza el sector lba en el cache sin tocar el disco. Retorna false si
+   no hay lugar (todos sucios u ocupados): hay que reintentar cuando la tarea
+   de disco haya bajado alguno */
+bool bcache_write(u32 lba, const void *data);
+
+/* Escribe un sector sucio; retorna false si no habia ninguno, si el disco
+   estaba ocupado o si fallo (queda sucio para la proxima) */
+bool bcache_flush(void);
+
+#endif
@@ -0,0 +1,148 @@
+/* Benchmark del nucleo del juego en Linux (make bench). Corre millones de
+   pasos con entradas fijas, sin pantalla ni teclado, y reporta ns por paso en
+   total y por subsistema, primero con los niveles tal como vienen y despues
+   con cada vez mas enemigos, y al final el sistema de particulas lleno. La
+   ultima columna son los bytes que ocupa cada imagen de la historia de
+   rebobinado contra el tamano de la imagen completa.
+
+   Uso: bench [assets.bin] [pasos] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "types.h"
+#include "platform.h"
+#include "asset.h"
+#include "level.h"
+#include "fixed.h"
+#include "particle.h"
+#include "game.h"
+
+#define DEFAULT_STEPS (1000000)
+
+static const char *const prof_names[PROF_COUNT] = {
+	"bullets", "enemies", "walls", "spawn", "collide", "particle", "snapshot", "timers"
+};
+
+/* Entradas del jugador, una por paso */
+static const enum input script[] = {
+	INPUT_FIRE, INPUT_LEFT, INPUT_FIRE, INPUT_LEFT,
+	INPUT_FIRE, INPUT_RIGHT, INPUT_FIRE, INPUT_RIGHT
+};
+
+u64 plat_time(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Juega steps pasos del nivel n de p. El jugador nunca pierde ni pasa de
+   nivel, para medir siempre lo mismo */
+static void run(const char *name, const struct level_pack *p, u32 n,
+		const struct sprite *s, u32 sprite_count, u32 steps){
+	u32 now = 0;
+
+	game_init(p, s, sprite_count);
+	level = n;
+	lvl = level_get(p, n);
+	game_input(INPUT_START);
+
+	memset(prof_time, 0, sizeof(prof_time));
+	prof_steps = 0;
+	history.pushes = 0;
+	history.bytes = 0;
+	prof_enabled = true;
+
+	u64 t0 = plat_time();
+	for (u32 i = 0; i < steps; i++){
+		lives = 1 << 16;
+		score = 0;
+		game_input(script[i % (sizeof(script) / sizeof(script[0]))]);
+		now += speed;
+		game_advance(now);
+		while (dirty){
+			dirty = false;
+			game_check();
+		}
+	}
+	u64 total = plat_time() - t0;
+	prof_enabled = false;
+
+	printf("%-10s %8u %10u %9.1f", name, enemy_count, steps, (double) total / steps);
+	for (u32 i = 0; i < PROF_COUNT; i++)
+		printf(" %8.1f", (double) prof_time[i] / steps);
+	printf(" %8.2f", enemy_count ? (double) total / steps / enemy_count : 0.0);
+	printf(" %6.0f/%-6u\n", history.pushes ? (double) history.bytes / history.pushes : 0.0, history.size);
+}
+
+/* Solo el sistema de particulas con el arreglo lleno: antes de cada paso se
+   repone lo que se apago con explosiones nuevas */
+static void run_particles(u32 steps){
+	u64 total = 0;
+
+	particles.count = 0;
+	for (u32 i = 0; i < steps; i++){
+		while (particles.count < MAX_PARTICLES)
+			particle_burst(FIX(40), FIX(12), 64, FIX(1) / 2, 20, RAMP_FIRE);
+		u64 t = plat_time();
+		particles_update();
+		total += plat_time() - t;
+	}
+	printf("\nparticulas %u: %.1f ns por paso, %.2f ns por particula\n",
+		MAX_PARTICLES, (double) total / steps, (double) total / steps / MAX_PARTICLES);
+}
+
+static u8 *load(const char *path, u32 *size){
+	static u8 buf[1 << 16] __attribute__((aligned(ASSET_ALIGN)));
+	FILE *f = fopen(path, "rb");
+	if (!f)
+		return 0;
+	*size = fread(buf, 1, sizeof(buf), f);
+	fclose(f);
+	return buf;
+}
+
+int main(int argc, char **argv){
+	const char *path = argc > 1 ? argv[1] : "assets.bin";
+	u32 steps = argc > 2 ? strtoul(argv[2], 0, 10) : DEFAULT_STEPS;
+	u32 size, sprite_count;
+	const u8 *archive = load(path, &size);
+	const struct sprite *s;
+	const struct level_pack *p;
+	char name[16];
+
+	if (!archive || !assets_open((const struct asset_archive *) archive, size)){
+		fprintf(stderr, "%s: no se pudo abrir '%s'\n", argv[0], path);
+		return 1;
+	}
+	s = asset_get("sprites", &size);
+	sprite_count = s ? size / sizeof(*s) : 0;
+	p = asset_get("levels", &size);
+	if (!sprite_count || !p || !levels_valid(p, size, sprite_count)){
+		fprintf(stderr, "%s: '%s' no tiene niveles o sprites validos\n", argv[0], path);
+		return 1;
+	}
+
+	printf("%u pasos por escenario (menos con mas de 64 enemigos), ns por paso\n", steps);
+	printf("%-10s %8s %10s %9s", "escenario", "enemigos", "pasos", "total");
+	for (u32 i = 0; i < PROF_COUNT; i++)
+		printf(" %8s", prof_names[i]);
+	printf(" %8s %13s\n", "ns/enem", "snap B/imagen");
+
+	/* Sin escalar: los niveles tal como vienen en el archivo */
+	for (u32 n = 0; n < p->count; n++){
+		snprintf(name, sizeof(name), "nivel %u", n + 1);
+		run(name, p, n, s, sprite_count, steps);
+	}
+
+	/* Escalando la cantidad de enemigos (con los niveles de la prueba de
+	   carga). Con mas enemigos se corren menos pasos */
+	for (u32 n = 8; n <= MAX_ENEMIES; n *= 2){
+		snprintf(name, sizeof(name), "escala %u", n);
+		run(name, stress_pack(p, n, 0), 0, s, sprite_count, n > 64 ? steps / (n / 64) : steps);
+	}
+
+	run_particles(steps / 64);
+	return 0;
+}
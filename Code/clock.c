@@ -0,0 +1,55 @@
+#include "types.h"
+#include "io.h"
+#include "clock.h"
+
+/* Devuelve el segundo campo enemigo[lyd] de el tiempo real del reloj (RTC)
+	Tenga en cuenta que el valor puede o no estar representado de tal manera que
+	debe formatearse en hexadecimal para mostrar al segundo enemigo[lyd]
+	(Es decir, 0x30 para el segundo 30) */
+
+u8 rtcs(void){
+	u8 last = 0, sec;
+	do { /* Hasta que el valor sea el mismo 2 veces*/
+		/*Esperar a que la actualizacion no este en curso*/
+		do{ 
+			outb(0x70, 0x0A); 
+		} while (inb(0x71) & 0x80);
+		outb(0x70, 0x00);
+		sec = inb(0x71); 
+	}while (sec != last && (last = sec) );
+	return sec;
+}
+
+/* EL numero de ticks de CPU por milisegundos */
+u64 tpms;
+
+/* Establezca el numeros de ticks por milisegundos del CPU basado en el numero de
+	ticks en el ultimo segundo, si el segundo ha cambiado desde la ultima llamada.
+	Solo lo usa clock_calibrate(): recalibrar con el juego andando cambiaria
+	la escala del tiempo del juego*/
+
+void tps (void){
+
+	static u64 ti = 0;
+	static u8 last_sec= 0xFF;
+	u8 sec= rtcs();
+	if (sec != last_sec){
+		last_sec = sec;
+		u64 tf = rdtsc();
+		tpms = (u32) ((tf - ti) >> 3) / 125; //Menos posibilidades de truncamiento
+		ti = tf;
+	}
+}
+
+/* Espera un segundo completo para calibrar el tiempo*/
+
+void clock_calibrate(void){
+	u64 itpms;
+	tps();
+	itpms=tpms;
+	while (tpms==itpms)
+		tps();
+	itpms=tpms;
+	while (tpms==itpms)
+		tps();
+}
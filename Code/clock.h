@@ -0,0 +1,37 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include "types.h"
+#include "io.h"
+
+/* EL numero de ticks de CPU por milisegundos */
+extern u64 tpms;
+
+u8 rtcs(void);
+void tps(void);
+
+/* Espera dos cambios de segundo del RTC para que tpms sea exacto. Despues
+   de esto tpms no cambia: todo el tiempo del kernel se mide con el */
+void clock_calibrate(void);
+
+/* Divide un numero de 64 bits entre uno de 32 con dos divl, para no depender
+   de las rutinas de division de 64 bits de libgcc */
+static inline u64 div_u64(u64 n, u32 d){
+	u32 hi = n >> 32, lo = n, qhi, qlo, r;
+	qhi = hi / d;
+	r = hi % d;
+	asm("divl %4" : "=a" (qlo), "=d" (r) : "a" (lo), "d" (r), "rm" (d));
+	return ((u64) qhi << 32) | qlo;
+}
+
+static inline u64 ms_ticks(u32 ms){
+	return tpms * ms;
+}
+
+/* Convierte ticks del TSC a microsegundos */
+static inline u32 ticks_us(u64 t){
+	u32 tpus = (u32) tpms / 1000;
+	return (u32) div_u64(t, tpus ? tpus : 1);
+}
+
+#endif
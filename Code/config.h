@@ -7,14 +7,38 @@
 /*Dimensiones de LEAD*/
 #define WELL_WIDTH (22)   // Ancho
 #define WELL_HEIGHT (20)  // Alto
-#define WELL_WIDTH2 (14)  // para nivel 2
 
 /*Intervalos iniciales en ms en que aplicar la gravedad*/
 #define INITIAL_SPEED (200)
 
+/* Balas del jugador en juego a la vez */
+#define BULLETS (5)
+
 /*Retraso en ms en que desaparecen enemigos*/
 #define CLEAR_DELAY (100)
 
+/* Particulas: ms entre sus pasos y cuantas salen en cada explosion */
+#define PARTICLE_TICK (33)
+#define PARTICLE_BURST (24)
+
+/* Pasos del juego que retrocede cada vez el rebobinado (la historia guarda
+   los que quepan en SNAP_RING, ver snapshot.h) */
+#define REWIND_STEPS (10)
+
+/* ms entre movimientos de la nave mientras se sostiene una direccion */
+#define MOVE_TICK (80)
+
+/* Repeticion del teclado (comando 0xF3): bits 5-6 retardo, 0-4 velocidad.
+   El juego lleva el estado de cada tecla y no usa la repeticion, asi que se
+   pide la mas lenta (1 s y 2 por segundo) para que lleguen menos bytes */
+#define KBD_TYPEMATIC (0x7F)
+
+/* Tiempo en ms que el jugador es invulnerable despues de perder una vida */
+#define INVULNERABLE_TIME (1500)
+
+/* Tiempo en ms que se muestran las pantallas de nivel, game over y victoria */
+#define SCREEN_DELAY (2000)
+
 /* PUNTAJE: El puntaje se incrementa en 3 por cada enemigo eliminado*/
 #define SCORE_FACTOR_1 (100)
 #define SCORE_FACTOR_2 (300)
@@ -30,3 +54,32 @@
 
 /* Number of rows that need to be cleared to increase level */
 #define ROWS_PER_LEVEL (10)
+
+/* Sector del disco con la tabla de records y cada cuantos ms la tarea de
+   disco baja lo que cambio */
+#define HISCORE_LBA (1)
+#define DISK_INTERVAL (500)
+
+/* Valores por omision de los ajustes de la linea de comandos (settings.h):
+   duracion del paso en % de la del nivel, cuadros por segundo como maximo
+   (0 = sin limite), esperar el retrazado vertical, semilla (0 = del TSC),
+   perfilador y sonido. La repeticion al sostener una direccion es MOVE_TICK */
+#define TICK_SCALE (100)
+#define RENDER_FPS (0)
+#define VSYNC (0)
+#define SEED (0)
+#define PROFILER (1)
+#define SOUND (1)
+
+/* Intervalo en ms entre reportes de telemetria por el puerto serie */
+#define TELEMETRY_INTERVAL (1000)
+
+/* Tiempo en us que puede tardar el renderizador en pintar un cuadro (60 Hz).
+   Si se pasa deja de pintar efectos y salta cuadros */
+#define FRAME_BUDGET (16667)
+
+/* Prueba de carga (opcion "stress" en la linea de comandos de GRUB): cada
+   STRESS_STEP_TIME ms se duplican enemigos, meteoritos y balas, STRESS_STEPS
+   veces (o las que diga "stress=N") */
+#define STRESS_STEP_TIME (5000)
+#define STRESS_STEPS (10)
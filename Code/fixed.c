@@ -0,0 +1,127 @@
+#include "types.h"
+#include "fixed.h"
+
+/* Solo usa division de 32 bits: la parte entera con una divl y la fraccion
+   bit a bit, como la division a mano, para no depender de __divdi3 */
+fixed fix_div(fixed a, fixed b){
+	bool neg = (a < 0) != (b < 0);
+	u32 ua = a < 0 ? -(u32) a : (u32) a;
+	u32 ub = b < 0 ? -(u32) b : (u32) b;
+
+	if (!ub || ua / ub >= 1u << (31 - FIX_SHIFT))
+		return neg ? (fixed) 0x80000000u : 0x7FFFFFFF;
+	u32 q = ua / ub, r = ua % ub;
+	for (u32 i = 0; i < FIX_SHIFT; i++){
+		u64 r2 = (u64) r << 1;
+		q <<= 1;
+		if (r2 >= ub){
+			r2 -= ub;
+			q |= 1;
+		}
+		r = r2;
+	}
+	return neg ? -(fixed) q : (fixed) q;
+}
+
+fixed fix_pow(fixed a, u32 n){
+	fixed r = FIX_ONE;
+	while (n){
+		if (n & 1)
+			r = fix_mul(r, a);
+		n >>= 1;
+		if (n)
+			a = fix_mul(a, a);
+	}
+	return r;
+}
+
+/* sin(i/256 * pi/2) para i = 0..256 */
+static const u32 sin_table[257] = {
+	0, 402, 804, 1206, 1608, 2010, 2412, 2814,
+	3216, 3617, 4019, 4420, 4821, 5222, 5623, 6023,
+	6424, 6824, 7224, 7623, 8022, 8421, 8820, 9218,
+	9616, 10014, 10411, 10808, 11204, 11600, 11996, 12391,
+	12785, 13180, 13573, 13966, 14359, 14751, 15143, 15534,
+	15924, 16314, 16703, 17091, 17479, 17867, 18253, 18639,
+	19024, 19409, 19792, 20175, 20557, 20939, 21320, 21699,
+	22078, 22457, 22834, 23210, 23586, 23961, 24335, 24708,
+	25080, 25451, 25821, 26190, 26558, 26925, 27291, 27656,
+	28020, 28383, 28745, 29106, 29466, 29824, 30182, 30538,
+	30893, 31248, 31600, 31952, 32303, 32652, 33000, 33347,
+	33692, 34037, 34380, 34721, 35062, 35401, 35738, 36075,
+	36410, 36744, 37076, 37407, 37736, 38064, 38391, 38716,
+	39040, 39362, 39683, 40002, 40320, 40636, 40951, 41264,
+	41576, 41886, 42194, 42501, 42806, 43110, 43412, 43713,
+	44011, 44308, 44604, 44898, 45190, 45480, 45769, 46056,
+	46341, 46624, 46906, 47186, 47464, 47741, 48015, 48288,
+	48559, 48828, 49095, 49361, 49624, 49886, 50146, 50404,
+	50660, 50914, 51166, 51417, 51665, 51911, 52156, 52398,
+	52639, 52878, 53114, 53349, 53581, 53812, 54040, 54267,
+	54491, 54714, 54934, 55152, 55368, 55582, 55794, 56004,
+	56212, 56418, 56621, 56823, 57022, 57219, 57414, 57607,
+	57798, 57986, 58172, 58356, 58538, 58718, 58896, 59071,
+	59244, 59415, 59583, 59750, 59914, 60075, 60235, 60392,
+	60547, 60700, 60851, 60999, 61145, 61288, 61429, 61568,
+	61705, 61839, 61971, 62101, 62228, 62353, 62476, 62596,
+	62714, 62830, 62943, 63054, 63162, 63268, 63372, 63473,
+	63572, 63668, 63763, 63854, 63944, 64031, 64115, 64197,
+	64277, 64354, 64429, 64501, 64571, 64639, 64704, 64766,
+	64827, 64884, 64940, 64993, 65043, 65091, 65137, 65180,
+	65220, 65259, 65294, 65328, 65358, 65387, 65413, 65436,
+	65457, 65476, 65492, 65505, 65516, 65525, 65531, 65535,
+	65536,
+};
+
+fixed fix_sin(u32 a){
+	u32 q = (a >> 14) & 3, i = a & 0x3FFF;
+	if (q & 1)
+		i = 0x4000 - i;
+	u32 n = i >> 6, f = i & 63;
+	fixed v = sin_table[n];
+	if (f)
+		v += (fixed) ((sin_table[n + 1] - sin_table[n]) * f >> 6);
+	return q & 2 ? -v : v;
+}
+
+/* sqrt((64 + k) / 256) para k = 0..192, o sea sqrt de [1/4, 1] */
+static const u32 sqrt_table[193] = {
+	32768, 33023, 33276, 33527, 33776, 34024, 34270, 34514,
+	34756, 34996, 35235, 35472, 35708, 35942, 36175, 36406,
+	36636, 36864, 37091, 37316, 37540, 37763, 37985, 38205,
+	38424, 38642, 38858, 39073, 39287, 39500, 39712, 39923,
+	40132, 40341, 40548, 40755, 40960, 41164, 41368, 41570,
+	41771, 41972, 42171, 42369, 42567, 42763, 42959, 43154,
+	43348, 43541, 43733, 43925, 44115, 44305, 44494, 44682,
+	44869, 45056, 45242, 45427, 45611, 45795, 45977, 46160,
+	46341, 46522, 46702, 46881, 47059, 47237, 47415, 47591,
+	47767, 47942, 48117, 48291, 48465, 48637, 48809, 48981,
+	49152, 49322, 49492, 49661, 49830, 49998, 50166, 50332,
+	50499, 50665, 50830, 50995, 51159, 51323, 51486, 51649,
+	51811, 51972, 52134, 52294, 52454, 52614, 52773, 52932,
+	53090, 53248, 53405, 53562, 53719, 53874, 54030, 54185,
+	54340, 54494, 54647, 54801, 54954, 55106, 55258, 55410,
+	55561, 55712, 55862, 56012, 56162, 56311, 56459, 56608,
+	56756, 56903, 57051, 57198, 57344, 57490, 57636, 57781,
+	57926, 58071, 58215, 58359, 58503, 58646, 58789, 58931,
+	59073, 59215, 59357, 59498, 59639, 59779, 59919, 60059,
+	60199, 60338, 60477, 60615, 60753, 60891, 61029, 61166,
+	61303, 61440, 61576, 61712, 61848, 61984, 62119, 62254,
+	62388, 62523, 62657, 62790, 62924, 63057, 63190, 63323,
+	63455, 63587, 63719, 63850, 63982, 64113, 64243, 64374,
+	64504, 64634, 64763, 64893, 65022, 65151, 65279, 65408,
+	65536,
+};
+
+/* x se corre una cantidad par de bits hasta quedar en [2^30, 2^32), que como
+   fraccion de 2^32 es [1/4, 1); la raiz de eso sale de la tabla y se corre
+   la mitad de bits de vuelta */
+fixed fix_sqrt(fixed x){
+	if (x <= 0)
+		return 0;
+	u32 z = __builtin_clz((u32) x) & ~1u;
+	u32 m = (u32) x << z;
+	u32 k = (m >> 24) - 64, f = (m >> 8) & 0xFFFF;
+	u32 v = sqrt_table[k] + ((sqrt_table[k + 1] - sqrt_table[k]) * f >> 16);
+	s32 shift = (FIX_SHIFT - (s32) z) / 2;
+	return shift >= 0 ? (fixed) (v << shift) : (fixed) (v >> -shift);
+}
@@ -0,0 +1,50 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+#include "types.h"
+
+/* Punto fijo 16.16: 16 bits de parte entera con signo y 16 de fraccion. Las
+   posiciones y velocidades del juego van en celdas y celdas por paso */
+
+typedef s32 fixed;
+
+#define FIX_SHIFT (16)
+#define FIX_ONE   (1 << FIX_SHIFT)
+
+/* Entero a punto fijo */
+#define FIX(n) ((fixed) (n) * FIX_ONE)
+
+/* Parte entera (hacia -infinito) */
+static inline s32 fix_int(fixed f){
+	return f >> FIX_SHIFT;
+}
+
+/* Desde el 8.8 de los niveles (ver level.h) */
+static inline fixed fix_from88(s16 v){
+	return (fixed) v * (1 << (FIX_SHIFT - 8));
+}
+
+/* El producto va en 64 bits; gcc lo hace con una sola mull, sin libgcc */
+static inline fixed fix_mul(fixed a, fixed b){
+	return (fixed) (((s64) a * b) >> FIX_SHIFT);
+}
+
+/* a / b, saturado al maximo (con el signo) si no cabe o b es 0 */
+fixed fix_div(fixed a, fixed b);
+
+/* a elevado a n por cuadrados sucesivos: log2(n) multiplicaciones */
+fixed fix_pow(fixed a, u32 n);
+
+/* Angulos en vueltas: FIX_ONE es una vuelta completa, asi que basta la
+   fraccion (0x4000 es un cuarto). Tabla de un cuarto de onda con
+   interpolacion lineal; el error es menor a 1/30000 */
+fixed fix_sin(u32 a);
+
+static inline fixed fix_cos(u32 a){
+	return fix_sin(a + FIX_ONE / 4);
+}
+
+/* Raiz cuadrada de x >= 0 (0 para negativos), por tabla con interpolacion */
+fixed fix_sqrt(fixed x);
+
+#endif
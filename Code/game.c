@@ -0,0 +1,1230 @@
+#include "config.h"
+#include "types.h"
+#include "platform.h"
+#include "wheel.h"
+#include "level.h"
+#include "asset.h"
+#include "fixed.h"
+#include "particle.h"
+#include "snapshot.h"
+#include "game.h"
+
+/* Perfilador: tiempo (en unidades de plat_time) que se paso en cada
+	subsistema. prof_inner suma todo lo medido, para descontarlo de lo que lo
+	contiene */
+bool prof_enabled;
+u64 prof_time[PROF_COUNT];
+u32 prof_steps;
+static u64 prof_inner;
+
+static inline u64 prof_begin(void){
+	return prof_enabled ? plat_time() : 0;
+}
+
+/* Suma a id el tiempo desde t y retorna el momento actual, para medir el
+	siguiente subsistema a continuacion */
+static inline u64 prof_lap(enum prof_id id, u64 t){
+	if (!prof_enabled)
+		return 0;
+	u64 now = plat_time();
+	prof_time[id] += now - t;
+	prof_inner += now - t;
+	return now;
+}
+
+
+struct wall_loc wall_I[MAX_WALL_ROWS];
+struct wall_loc wall_D[MAX_WALL_ROWS];
+
+
+struct ship_inf player; /* Hacemos que jugador sea una estructura conformada por la estructura ship_inf*/
+struct bullet_ship bullet[MAX_BULLETS]; // un array para que se puedan disparar solo bullet_limit balas seguidas.
+u32 bullet_limit = BULLETS;
+
+/* Enemigos y meteoritos del nivel actual: los miembros de todas sus oleadas */
+struct ship_inf enemy[MAX_ENEMIES];
+u32 enemy_count;
+struct formation formation[MAX_WAVES];
+
+u32 speed= INITIAL_SPEED, score=0, lives=4, level=0;
+u32 level_score;
+u32 tick_scale = TICK_SCALE;
+
+/* ms de un paso del nivel con tick_scale aplicado, al menos 1 */
+u32 scale_tick(u32 ms){
+	u32 t = ms * tick_scale / 100;
+	return t ? t : 1;
+}
+
+/* Niveles y sprites del archivo de recursos, leidos directamente de esa
+	memoria, y el nivel que se esta jugando */
+const struct level_pack *pack;
+const struct level *lvl;
+const struct sprite *sprites;
+u32 sprite_count;
+
+/* Temporizadores del juego (ver wheel.h). Su tiempo son los ms que pasa la
+	plataforma a game_advance() */
+struct wheel wheel;
+
+/* Eventos programados en la rueda de temporizadores */
+
+bool player_safe; // Invulnerable despues de perder una vida
+
+/* Columna del miembro m de la oleada w (las columnas dan la vuelta al area) */
+s8 wave_col(const struct wave *w, u8 m){
+	s32 span = lvl->max_x - lvl->min_x + 1;
+	s32 v = (w->x0 - lvl->min_x + m * w->dx) % span;
+	return lvl->min_x + (v + span) % span;
+}
+
+/* Suelta el enemigo e en la posicion que le toca dentro de su oleada */
+void release_enemy(void *arg){
+	u32 e = (u32) (uptr) arg;
+	const struct wave *w = &lvl->wave[enemy[e].wave];
+	enemy[e].i = w->sprite;
+	enemy[e].x = enemy[e].ox = FIX(wave_col(w, enemy[e].member));
+	enemy[e].y = enemy[e].oy = FIX(w->y0);
+	fixed v = fix_from88(w->v);
+	enemy[e].vx = fix_mul(v, fix_sin(w->angle << 8));
+	enemy[e].vy = fix_mul(v, fix_cos(w->angle << 8));
+	enemy[e].sale = false;
+	enemy[e].explota = false;
+	enemy[e].estado = true;
+}
+
+/* El enemigo sale del juego y vuelve a soltarse despues del respawn_ms de su
+	oleada. Los de una formacion vuelven todos juntos (ver move_formation) */
+void kill_enemy(u32 e){
+	const struct wave *w = &lvl->wave[enemy[e].wave];
+	enemy[e].estado = false;
+	enemy[e].explota = false;
+	if(!w->path)
+		wheel_schedule(&wheel, w->respawn_ms, release_enemy, (void *) (uptr) e);
+}
+
+/* Fin de la explosion de un enemigo (CLEAR_DELAY despues del impacto) */
+void clear_enemy(void *arg){
+	kill_enemy((u32) (uptr) arg);
+}
+
+void end_safe(void *arg){
+	player_safe = false;
+}
+
+u32 sounds;
+
+/* En la prueba de carga no suena nada */
+void play(enum sound s){
+	if(!stress_mode)
+		sounds |= 1u << s;
+}
+
+/* El jugador pierde una vida y queda invulnerable INVULNERABLE_TIME ms */
+void hurt_player(void){
+	lives -= 1;
+	play(SOUND_CRASH);
+	player.estado = false;
+	player_safe = true;
+	wheel_schedule(&wheel, INVULNERABLE_TIME, end_safe, 0);
+}
+
+/* Funcion para detectar colision con paredes de la zona de juego*/
+
+bool collide(s8 x, s8 y){
+	if (x<lvl->min_x || x>lvl->max_x || y<2 || y>lvl->bottom)
+		return true;
+	else
+		return false;
+}
+
+/* Colision del jugador con las paredes del tunel en su fila */
+
+bool collide_tunnel(s8 x, s8 y){
+	u8 row = y - lvl->tunnel_top;
+	if (row >= lvl->tunnel_rows)
+		return false;
+	if (x <= wall_I[row].x || (x + sprites[0].w) >= wall_D[row].x){
+		if (!player_safe)
+			hurt_player();
+		return true;
+	}
+	else
+		return false;
+}
+
+
+///////////// Funciones para la deteccion de colision /////////////////////
+
+/* Colision barrida: a (de aw x ah) se mueve respecto de b (de bw x bh) de r0
+	a r1 en el paso. En cada eje el tramo de tiempo en que se solapan es una
+	"losa"; chocan si las losas de x e y se cruzan dentro del paso. Primero se
+	descarta con la caja del recorrido, que es lo comun y no divide */
+
+static bool slab(fixed r0, fixed r1, fixed lo, fixed hi, fixed *t0, fixed *t1){
+	fixed d = r1 - r0;
+	if(!d)
+		return r0 > lo && r0 < hi;
+	fixed a = fix_div(lo - r0, d), b = fix_div(hi - r0, d);
+	if(a > b){
+		fixed t = a;
+		a = b;
+		b = t;
+	}
+	if(a > *t0)
+		*t0 = a;
+	if(b < *t1)
+		*t1 = b;
+	return *t0 < *t1;
+}
+
+static inline bool span_out(fixed r0, fixed r1, fixed lo, fixed hi){
+	return (r0 < r1 ? r1 : r0) <= lo || (r0 < r1 ? r0 : r1) >= hi;
+}
+
+bool sweep(fixed rx0, fixed ry0, fixed rx1, fixed ry1, fixed aw, fixed ah, fixed bw, fixed bh){
+	if(span_out(rx0, rx1, -aw, bw) || span_out(ry0, ry1, -ah, bh))
+		return false;
+	fixed t0 = 0, t1 = FIX_ONE;
+	return slab(rx0, rx1, -aw, bw, &t0, &t1) && slab(ry0, ry1, -ah, bh, &t0, &t1);
+}
+
+/* a contra b, ambos con su posicion al empezar y al terminar el paso */
+static inline bool hit(const struct ship_inf *a, const struct sprite *as, const struct ship_inf *b, const struct sprite *bs){
+	return sweep(a->ox - b->ox, a->oy - b->oy, a->x - b->x, a->y - b->y,
+		FIX(as->w), FIX(as->h), FIX(bs->w), FIX(bs->h));
+}
+
+/* colision bala con enemigo*/
+
+void colision_B_E(void){
+/* Primero hacemos un for que recorra cada una de las balas, donde verifique si esa bala ha impactado
+	a alguno de los enemigos, enemigos que se recorren con otro for*/
+
+	for(u32 yy=0; yy<bullet_limit; yy++){
+		struct bullet_ship *b = &bullet[yy];
+		if(b->estado){
+			for(u32 xx=0; xx<enemy_count; xx++){
+				struct ship_inf *e = &enemy[xx];
+				if(!e->estado || e->explota)
+					continue;
+				if(!(lvl->wave[e->wave].flags & WAVE_SHOOTABLE))
+					continue;
+				const struct sprite *sp = &sprites[e->i];
+				fixed bx = FIX(b->x);
+				if(sweep(bx - e->ox, b->oy - e->oy, bx - e->x, b->y - e->y, FIX(1), FIX(1), FIX(sp->w), FIX(sp->h))){
+					particle_burst(e->x + FIX(sp->w) / 2, e->y + FIX(sp->h) / 2,
+						PARTICLE_BURST, FIX(1) / 2, 20, RAMP_FIRE);
+					e->explota=true;
+					b->estado=false;
+					score += 1;
+					play(SOUND_HIT);
+					wheel_schedule(&wheel, CLEAR_DELAY, clear_enemy, (void *) (uptr) xx);
+					break;
+				}
+
+			}
+		}
+	}
+}
+
+/* Colision enemigo (o meteorito) con jugador*/
+
+void colision_E_P(void){
+	if(player_safe || !player.estado)
+		return;
+	const struct sprite *ps = &sprites[player.i];
+	for(u32 e=0; e<enemy_count; e++){
+		if(enemy[e].estado && !enemy[e].explota){
+			const struct sprite *sp = &sprites[enemy[e].i];
+			if(hit(&enemy[e], sp, &player, ps)){
+				particle_burst(player.x + FIX(ps->w) / 2, player.y,
+					PARTICLE_BURST, FIX(1) / 2, 16, RAMP_DUST);
+				kill_enemy(e);
+				hurt_player();
+				return;
+			}
+		}
+	}
+}
+
+/* Despues de revisar colisiones: lo que llego al borde sale del juego (los
+	enemigos cuestan una vida o dan un punto segun su oleada) y el tramo
+	recorrido empieza de nuevo donde esta cada uno */
+
+void end_sweep(void){
+	for(u32 bb=0; bb<bullet_limit; bb++){
+		if(bullet[bb].sale)
+			bullet[bb].estado = bullet[bb].sale = false;
+		bullet[bb].oy = bullet[bb].y;
+	}
+	for(u32 e=0; e<enemy_count; e++){
+		if(enemy[e].sale && enemy[e].estado && !enemy[e].explota){
+			u8 flags = lvl->wave[enemy[e].wave].flags;
+			if(flags & WAVE_EXIT_LIFE){
+				lives -=1;
+				play(SOUND_CRASH);
+			}
+			if(flags & WAVE_EXIT_SCORE)
+				score += 1;
+			kill_enemy(e);
+		}
+		enemy[e].sale = false;
+		enemy[e].ox = enemy[e].x;
+		enemy[e].oy = enemy[e].y;
+	}
+	player.ox = player.x;
+	player.oy = player.y;
+}
+
+/* Paredes del tunel: la izquierda oscila entre tunnel_min y tunnel_max y la
+	derecha la sigue a tunnel_gap unidades */
+
+void init_tunnel(void){
+	u8 x;
+	u8 cont=0, half=lvl->tunnel_max - lvl->tunnel_min;
+	s8 posicion_x=lvl->tunnel_max;
+	bool direccion=true;
+
+	for(x=0; x<lvl->tunnel_rows && x<MAX_WALL_ROWS; x++){
+		if(posicion_x >= lvl->tunnel_min && cont < half){
+			posicion_x = posicion_x - 1;
+			direccion=true;
+			cont +=1;
+		}
+		if(posicion_x <= lvl->tunnel_max && cont >= half){
+			posicion_x = posicion_x + 1;
+			direccion=false;
+			cont +=1;
+		}
+		wall_I[x].x=posicion_x;
+		wall_I[x].y=lvl->tunnel_top + x;
+		wall_I[x].direccion=direccion;
+		wall_D[x]=wall_I[x];
+		wall_D[x].x=posicion_x + lvl->tunnel_gap;
+
+		if (cont == 2*half - 1)
+			cont = 0;
+	}
+}
+
+/* Avanza el movimiento de las paredes del tunel un paso */
+
+void step_walls(void){
+	for(u8 x=0; x<lvl->tunnel_rows && x<MAX_WALL_ROWS; x++){
+
+		if(wall_I[x].x >= lvl->tunnel_min && wall_I[x].direccion==true){
+			wall_I[x].x -=1;
+		}
+
+		if(wall_I[x].x <= lvl->tunnel_max && wall_I[x].direccion==false){
+			wall_I[x].x +=1;
+		}
+
+		if(wall_I[x].x == lvl->tunnel_min)
+			wall_I[x].direccion = false;
+		if(wall_I[x].x == lvl->tunnel_max)
+			wall_I[x].direccion = true;
+
+		wall_D[x].x = wall_I[x].x + lvl->tunnel_gap;
+	}
+}
+
+/* Funcion para inicializar los diferentes aspectos de los personajes del
+	nivel actual (player, enemigos, balas y paredes) */
+
+void init(void){
+	player.i=0;
+	player.y=player.oy=FIX(lvl->player_y);
+	player.x=player.ox=FIX(lvl->player_x);
+	player.estado= false;
+	player_safe=false;
+
+	/* Inicializar los valores de las balas*/
+	/* se realiza con un for debido a que es un array */
+	for(int xx=0; xx<MAX_BULLETS; xx++){
+		bullet[xx].y= bullet[xx].oy= player.y - FIX(1);
+		bullet[xx].x= fix_int(player.x) + 1;
+		bullet[xx].estado = false;
+		bullet[xx].sale = false;
+	}
+
+	/* Cada miembro de cada oleada ocupa un enemigo; los de una oleada quedan
+		seguidos */
+	enemy_count=0;
+	for(u8 w=0; w<lvl->wave_count; w++){
+		formation[w] = (struct formation) {.first = enemy_count};
+		for(u8 m=0; m<lvl->wave[w].count && enemy_count<MAX_ENEMIES; m++){
+			enemy[enemy_count].wave=w;
+			enemy[enemy_count].member=m;
+			enemy[enemy_count].estado=false;
+			enemy[enemy_count].explota=false;
+			enemy[enemy_count].sale=false;
+			enemy_count++;
+		}
+		formation[w].count = enemy_count - formation[w].first;
+	}
+
+	if(lvl->flags & LVF_TUNNEL)
+		init_tunnel();
+
+	particles.count = 0;
+
+	speed=scale_tick(lvl->tick_ms);
+}
+
+/* Se crea una funcion que permita ver el estado de la nave para saber si
+	si tiene que spawnear otra segun el estado. Los enemigos vuelven por su
+	cuenta con release_enemy() */
+void spawnear (void){
+
+	if(player.estado==false){
+		player.y=player.oy=FIX(lvl->player_y);
+		player.x=player.ox=FIX(lvl->player_x);
+		player.estado= true;
+	}
+}
+
+s8 move_wall=0;
+
+////////// Funciones de movimiento //////////
+
+/* Intenta mover la nave una distancia dx y dy, devuelve true si tiene exito.
+	En los niveles con tunel chocar con sus paredes quita una vida */
+
+bool move_player(s8 dx, s8 dy){
+	if(!(player.estado))
+		return false;
+	s8 x = fix_int(player.x), y = fix_int(player.y);
+	if(lvl->flags & LVF_TUNNEL){
+		if(collide_tunnel(x + dx, y + dy))
+			return false;
+	}
+	else if(collide(x + dx, y+dy)){
+		return false;
+	}
+	player.x += FIX(dx);
+	player.y += FIX(dy);
+	return true;
+}
+
+/* Las balas y los enemigos avanzan su velocidad en cada paso. Si pasan el
+	borde quedan en el y se marcan para salir en end_sweep(), asi igual se
+	revisa lo que tocaron en el camino */
+
+void move_bullet(u32 b){
+	if (!(bullet[b].estado) || bullet[b].sale)
+		return;
+	bullet[b].y += bullet[b].vy;
+	if (fix_int(bullet[b].y) < 2){
+		bullet[b].y = FIX(2);
+		bullet[b].sale = true;
+	}
+}
+
+void move_enemy(u32 e){
+	if(!(enemy[e].estado) || enemy[e].sale)
+		return;
+	/* Los que van en diagonal rebotan en los lados del area de juego */
+	if(enemy[e].vx){
+		const struct sprite *sp = &sprites[enemy[e].i];
+		enemy[e].x += enemy[e].vx;
+		if(fix_int(enemy[e].x) < lvl->min_x){
+			enemy[e].x = FIX(lvl->min_x);
+			enemy[e].vx = -enemy[e].vx;
+		}
+		else if(fix_int(enemy[e].x) + sp->w - 1 > lvl->max_x){
+			enemy[e].x = FIX(lvl->max_x - sp->w + 1);
+			enemy[e].vx = -enemy[e].vx;
+		}
+	}
+	enemy[e].y += enemy[e].vy;
+	if(fix_int(enemy[e].y) > lvl->bottom){
+		enemy[e].y = FIX(lvl->bottom);
+		enemy[e].sale = true;
+	}
+}
+
+/////////// Formaciones /////////////////
+
+/* Una formacion es una oleada con trayectoria (level.h). Cada paso se mueve el
+	ancla y despues, en una sola pasada por sus miembros, cada uno queda en
+	ancla + su columna + la trayectoria en su paso (t - miembro * stride). La
+	trayectoria se elige una vez por formacion y no por enemigo */
+
+static inline void put_member(struct ship_inf *e, fixed x, fixed y, fixed lo, fixed hi){
+	e->x = x < lo ? lo : x > hi ? hi : x;
+	e->y = y;
+	if(fix_int(y) > lvl->bottom){
+		e->y = FIX(lvl->bottom);
+		e->sale = true;
+	}
+}
+
+/* Angulo (en 1/65536 de vuelta) del paso u de una onda de period pasos.
+	Se reduce a un periodo antes de escalar, asi es exacto y no desborda
+	aunque la formacion lleve mucho en juego */
+static inline u32 path_phase(s32 u, s32 period){
+	s32 r = u % period;
+	if(r < 0)
+		r += period;
+	return r * 65536 / period;
+}
+
+/* Pone cada miembro en su lugar del paso f->t; retorna cuantos siguen en
+	juego (incluidos los que explotan) */
+u32 place_formation(u32 w){
+	const struct formation *f = &formation[w];
+	const struct wave *wv = &lvl->wave[w];
+	const struct sprite *sp = &sprites[wv->sprite];
+	fixed lo = FIX(lvl->min_x), hi = FIX(lvl->max_x - sp->w + 1);
+	fixed amp = FIX(wv->amp), y0 = FIX(wv->y0) + f->ay;
+	struct ship_inf *e = &enemy[f->first];
+	u32 alive = 0;
+
+	switch(wv->path){
+		case PATH_SINE:
+			for(u32 m=0; m<f->count; m++, e++){
+				alive += e->estado;
+				if(!e->estado || e->explota || e->sale)
+					continue;
+				s32 u = (s32) f->t - (s32) (m * wv->stride);
+				put_member(e, FIX(wave_col(wv, m)) + f->ax + fix_mul(amp, fix_sin(path_phase(u, wv->period))), y0, lo, hi);
+			}
+			break;
+
+		case PATH_DIVE:{
+			/* u^2 / period como u * (u / period): u^2 solo no cabe en 16.16
+				pasado u = 181 (si el ancla sube siguen en pantalla) */
+			fixed inv = fix_div(FIX_ONE, FIX(wv->period));
+			for(u32 m=0; m<f->count; m++, e++){
+				alive += e->estado;
+				if(!e->estado || e->explota || e->sale)
+					continue;
+				s32 u = (s32) f->t - (s32) (m * wv->stride);
+				fixed x = FIX(wave_col(wv, m)) + f->ax;
+				if(u <= 0)
+					put_member(e, x, y0, lo, hi);
+				else
+					put_member(e, x + fix_mul(amp, fix_sin(path_phase(u, 2 * wv->period))),
+						y0 + fix_mul(FIX(u), fix_mul(FIX(u), inv)), lo, hi);
+			}
+			break;
+		}
+	}
+	return alive;
+}
+
+/* Suelta completa la formacion w desde su lugar de salida */
+void release_formation(void *arg){
+	u32 w = (u32) (uptr) arg;
+	struct formation *f = &formation[w];
+	const struct wave *wv = &lvl->wave[w];
+	fixed v = fix_from88(wv->v);
+
+	f->active = true;
+	f->t = 0;
+	f->ax = f->ay = 0;
+	f->vx = fix_mul(v, fix_sin(wv->angle << 8));
+	f->vy = fix_mul(v, fix_cos(wv->angle << 8));
+	for(u32 e=f->first; e<f->first + f->count; e++){
+		enemy[e].i = wv->sprite;
+		enemy[e].vx = f->vx;
+		enemy[e].vy = f->vy;
+		enemy[e].sale = false;
+		enemy[e].explota = false;
+		enemy[e].estado = true;
+	}
+	place_formation(w);
+	for(u32 e=f->first; e<f->first + f->count; e++){
+		enemy[e].ox = enemy[e].x;
+		enemy[e].oy = enemy[e].y;
+	}
+}
+
+/* Un paso de la formacion w. Si ya no le queda nadie vuelve a salir despues
+	del respawn_ms de su oleada */
+void move_formation(u32 w){
+	struct formation *f = &formation[w];
+	if(!f->active)
+		return;
+	f->t++;
+	f->ax += f->vx;
+	f->ay += f->vy;
+	if(!place_formation(w)){
+		f->active = false;
+		wheel_schedule(&wheel, lvl->wave[w].respawn_ms, release_formation, (void *) (uptr) w);
+	}
+}
+
+/* Pone una bala libre en x, y; retorna false si ya hay bullet_limit en juego */
+bool fire_at(s8 x, s8 y){
+	for(u32 bb = 0; bb<bullet_limit; bb++){
+		if(bullet[bb].estado==false){
+			bullet[bb].estado=true;
+			bullet[bb].sale=false;
+			bullet[bb].x = x;
+			bullet[bb].y = bullet[bb].oy = FIX(y);
+			bullet[bb].vy = -fix_from88(lvl->bullet_v);
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Funcion que permite colocar el estado de la bala en True en caso de que se dispare
+	eso sucede cuando la funcion se llama*/
+void disparar(void){
+	if(fire_at(fix_int(player.x) + 1, fix_int(player.y) - 1))
+		play(SOUND_SHOT);
+}
+
+/* Funcion para actualizar el estado de ciertos elementos como:
+	movimiento de bala, enemigos y paredes*/
+void update(void){
+	u64 t = prof_begin();
+
+	for(u32 bb=0; bb<bullet_limit; bb++)
+		move_bullet(bb);
+	t = prof_lap(PROF_BULLETS, t);
+
+	/* Una pasada por oleada: las formaciones se mueven juntas y en las demas
+		cada enemigo por su cuenta. Los que explotan se quedan quietos hasta
+		que clear_enemy() los quite */
+	for(u32 w=0; w<lvl->wave_count; w++){
+		const struct formation *f = &formation[w];
+		if(lvl->wave[w].path){
+			move_formation(w);
+			continue;
+		}
+		for(u32 ee=f->first; ee<f->first + f->count; ee++){
+			if(!enemy[ee].explota)
+				move_enemy(ee);
+		}
+	}
+	t = prof_lap(PROF_ENEMIES, t);
+
+	// Para crear efecto de movimiento en las paredes//
+	if(lvl->flags & LVF_WELL){
+		if(move_wall < 5)
+			move_wall +=1;
+		else
+			move_wall=0;
+	}
+
+	if(lvl->flags & LVF_TUNNEL)
+		step_walls();
+	prof_lap(PROF_WALLS, t);
+}
+
+/* Funcion para detectar cuando se ha perdido el juego GAME OVER */
+
+bool game_over(){
+	if(lives==0){
+		lives=4;
+		return true;
+	}
+	return false;
+}
+
+/* Records: al terminar una partida el puntaje entra en la tabla si supera al
+	ultimo (o si hay lugar) */
+
+struct hiscore_table hiscores = {.magic = HISCORE_MAGIC};
+bool hiscores_dirty;
+
+static u32 hiscores_sum(const struct hiscore_table *t){
+	return asset_sum(t, (const u8 *) &t->sum - (const u8 *) t);
+}
+
+bool hiscores_load(const void *p){
+	const struct hiscore_table *t = p;
+	if(t->magic != HISCORE_MAGIC || t->count > HISCORES || t->sum != hiscores_sum(t)){
+		hiscores = (struct hiscore_table) {.magic = HISCORE_MAGIC};
+		return false;
+	}
+	hiscores = *t;
+	return true;
+}
+
+void hiscore_add(u32 points, u32 reached){
+	u32 i = hiscores.count;
+	if(!points || stress_mode)
+		return;
+	if(i == HISCORES){
+		if(points <= hiscores.entry[i - 1].score)
+			return;
+		i--;
+	}
+	else
+		hiscores.count++;
+	for(; i > 0 && hiscores.entry[i - 1].score < points; i--)
+		hiscores.entry[i] = hiscores.entry[i - 1];
+	hiscores.entry[i] = (struct hiscore) {points, reached};
+	hiscores.sum = hiscores_sum(&hiscores);
+	hiscores_dirty = true;
+}
+
+/* Funcion para detectar cambio de nivel: el puntaje es acumulado */
+bool next_level(void){
+	return score >= lvl->win_score;
+}
+
+/////////// Simulacion /////////////////
+
+/* La simulacion es un ciclo de eventos: entradas del jugador y temporizadores
+	de la rueda (pasos del juego, enemigos que se sueltan, explosiones,
+	invulnerabilidad y cambios de pantalla) */
+
+enum screen screen;	// Pantalla actual
+bool dirty;		// Hay cambios que publicar
+void show(enum screen s){
+	screen = s;
+	dirty = true;
+}
+
+void stress_fire(void);	// ver Prueba de carga
+void snapshot_save(void);	// ver Rebobinado
+void snapshot_start(void);
+void rewind_state(void);
+void hold_start(void);	// ver game_key
+
+/* Curva de dificultad: el paso se acorta de tick_ms a tick_min a medida que
+	el puntaje del nivel se acerca a win_score */
+u32 level_speed(void){
+	if(lvl->win_score <= level_score || score < level_score)
+		return scale_tick(lvl->tick_ms);
+	u32 goal = lvl->win_score - level_score, done = score - level_score;
+	if(done > goal)
+		done = goal;
+	return scale_tick(lvl->tick_ms - (lvl->tick_ms - lvl->tick_min) * done / goal);
+}
+
+/* Un paso del juego cada speed ms mientras se juega un nivel */
+void step(void *arg){
+	snapshot_save();
+	update();
+	u64 t = prof_begin();
+	spawnear();
+	if(stress_mode)
+		stress_fire();
+	prof_lap(PROF_SPAWN, t);
+	prof_steps++;
+	dirty = true;
+	speed = level_speed();
+	wheel_schedule(&wheel, speed, step, 0);
+}
+
+void enter_about(void *arg){
+	wheel_clear(&wheel);
+	level = 0;
+	score = 0;
+	lvl = level_get(pack, level);
+	init();
+	show(SCREEN_ABOUT);
+}
+
+/* Particulas, cada PARTICLE_TICK ms mientras se juega un nivel, aparte del
+	paso del juego para que se muevan suave aunque el paso sea largo. La nave
+	deja una estela que se abre a un lado y al otro */
+void effects_step(void *arg){
+	static u32 tick;
+	u64 t = prof_begin();
+	if(player.estado){
+		const struct sprite *ps = &sprites[player.i];
+		fixed vx = tick++ & 1 ? FIX(1) / 8 : -FIX(1) / 8;
+		particle_emit(player.x + FIX(ps->w) / 2, player.y + FIX(ps->h), vx, FIX(1) / 2, 6, RAMP_THRUST);
+	}
+	particles_update();
+	prof_lap(PROF_PARTICLES, t);
+	if(particles.count)
+		dirty = true;
+	wheel_schedule(&wheel, PARTICLE_TICK, effects_step, 0);
+}
+
+/* Arranca el nivel actual: cada miembro de cada oleada se suelta en su paso */
+void start_level(void *arg){
+	init();
+	level_score = score;
+	spawnear();
+	snapshot_start();
+	for(u32 w=0; w<lvl->wave_count; w++){
+		const struct wave *wv = &lvl->wave[w];
+		const struct formation *f = &formation[w];
+		if(wv->path){
+			wheel_schedule(&wheel, wv->release * speed, release_formation, (void *) (uptr) w);
+			continue;
+		}
+		for(u32 e=f->first; e<f->first + f->count; e++)
+			wheel_schedule(&wheel, (wv->release + enemy[e].member * wv->stride) * speed, release_enemy, (void *) (uptr) e);
+	}
+	wheel_schedule(&wheel, 1, step, 0);
+	wheel_schedule(&wheel, PARTICLE_TICK, effects_step, 0);
+	show(SCREEN_PLAY);
+	hold_start();
+}
+
+/* Termina el nivel: cancela todo lo pendiente, muestra s y despues de
+	SCREEN_DELAY ms sigue con then */
+void end_level(enum screen s, timer_fn then){
+	wheel_clear(&wheel);
+	show(s);
+	wheel_schedule(&wheel, SCREEN_DELAY, then, 0);
+}
+
+/* Teclas sostenidas: held tiene un bit por entrada apretada. Mientras haya
+	una direccion apretada hold_step mueve la nave cada move_tick ms hacia la
+	ultima que se apreto; solo hay temporizador mientras dure */
+
+u32 move_tick = MOVE_TICK;
+u32 held;
+enum input last_dir;
+timer_id hold_timer;
+
+#define HELD_DIRS ((1u << INPUT_LEFT) | (1u << INPUT_RIGHT))
+
+s8 hold_dx(void){
+	enum input dir = last_dir;
+	if(!(held & (1u << dir)))
+		dir = held & (1u << INPUT_LEFT) ? INPUT_LEFT : INPUT_RIGHT;
+	if(!(held & (1u << dir)))
+		return 0;
+	return dir == INPUT_LEFT ? -lvl->player_step : lvl->player_step;
+}
+
+void hold_step(void *arg){
+	s8 dx = hold_dx();
+	hold_timer = 0;
+	if(screen != SCREEN_PLAY || !dx)
+		return;
+	move_player(dx, 0);
+	dirty = true;
+	hold_timer = wheel_schedule(&wheel, move_tick, hold_step, 0);
+}
+
+/* (Re)arranca la repeticion; despues de un wheel_clear el id viejo ya no
+	cancela nada */
+void hold_start(void){
+	wheel_cancel(&wheel, hold_timer);
+	hold_timer = 0;
+	if(screen == SCREEN_PLAY && (held & HELD_DIRS))
+		hold_timer = wheel_schedule(&wheel, move_tick, hold_step, 0);
+}
+
+void game_key(enum input in, bool down){
+	u32 bit = 1u << in;
+	if(in == INPUT_NONE)
+		return;
+	if(!down){
+		held &= ~bit;
+		if(!(held & HELD_DIRS)){
+			wheel_cancel(&wheel, hold_timer);
+			hold_timer = 0;
+		}
+		return;
+	}
+	if(held & bit)
+		return;
+	held |= bit;
+	game_input(in);
+	if(bit & HELD_DIRS){
+		last_dir = in;
+		hold_start();
+	}
+}
+
+void game_input(enum input in){
+	switch (screen){
+		case SCREEN_ABOUT:
+			if (in == INPUT_START)
+				start_level(0);
+			break;
+
+		case SCREEN_PLAY:
+			switch (in){
+				case INPUT_RIGHT:
+					move_player(lvl->player_step,0);
+					break;
+
+				case INPUT_LEFT:
+					move_player(-lvl->player_step,0);
+					break;
+
+				case INPUT_FIRE:
+					if(lvl->flags & LVF_SHOOT)
+						disparar();
+					break;
+
+				case INPUT_REWIND:
+					if(!stress_mode)
+						rewind_state();
+					break;
+
+				default:
+					break;
+			}
+			dirty = true;
+			break;
+
+		default:
+			break;
+	}
+}
+
+/* Colisiones y fin de nivel, despues de publicar cada cambio */
+void game_check(void){
+	if(screen != SCREEN_PLAY)
+		return;
+	u64 t = prof_begin();
+	colision_B_E();
+	colision_E_P();
+	end_sweep();
+	prof_lap(PROF_COLLIDE, t);
+
+	/* En la prueba de carga no se pierde ni se pasa de nivel */
+	if(stress_mode){
+		lives = 4;
+		score = 0;
+		return;
+	}
+
+	if(game_over()){ // Comprueba si hemos perdido todas las vidas
+		hiscore_add(score, level + 1);
+		play(SOUND_GAMEOVER);
+		end_level(SCREEN_GAMEOVER, enter_about);
+	}
+	else if(next_level()){
+		if(level + 1 < pack->count){
+			level += 1;
+			lvl = level_get(pack, level);
+			play(SOUND_LEVEL);
+			end_level(SCREEN_BANNER, start_level);
+		}
+		else{
+			hiscore_add(score, level + 1);
+			play(SOUND_WIN);
+			end_level(SCREEN_WIN, enter_about);
+		}
+	}
+}
+
+/////////// Prueba de carga /////////////////
+
+/* Un nivel armado en memoria con la geometria del primer nivel y oleadas de
+	STRESS_WAVE enemigos y meteoritos, copiadas de las primeras oleadas de ese
+	tipo que haya en los niveles. Cada paso de la prueba duplica todo */
+
+#define STRESS_WAVE (200)
+#define STRESS_WAVES (2 * MAX_ENEMIES / STRESS_WAVE + 2)
+
+bool stress_mode;
+u32 stress_step;
+u32 stress_steps = STRESS_STEPS;
+
+static const struct level_pack *stress_saved;	// niveles normales
+static u32 stress_col;				// columna de la siguiente bala
+
+/* Primera oleada de los niveles de p que se puede (o no) destruir */
+static const struct wave *find_wave(const struct level_pack *p, bool shootable){
+	for(u32 n=0; n<p->count; n++){
+		const struct level *l = level_get(p, n);
+		for(u8 w=0; w<l->wave_count; w++)
+			if(!(l->wave[w].flags & WAVE_SHOOTABLE) == !shootable)
+				return &l->wave[w];
+	}
+	return 0;
+}
+
+static u32 add_waves(struct level *l, const struct wave *tpl, u32 n){
+	for(; n && l->wave_count < STRESS_WAVES; l->wave_count++){
+		struct wave *w = &l->wave[l->wave_count];
+		*w = *tpl;
+		w->count = n < STRESS_WAVE ? n : STRESS_WAVE;
+		w->x0 = l->min_x + l->wave_count;
+		w->dx = 1;
+		w->release = l->wave_count % 16;
+		w->stride = 0;
+		n -= w->count;
+	}
+	return n;
+}
+
+const struct level_pack *stress_pack(const struct level_pack *p, u32 enemies, u32 meteors){
+	static struct{
+		struct level_pack pack;
+		u32 offset;
+		struct level level;
+		struct wave wave[STRESS_WAVES];
+	} s;
+	const struct wave *e = find_wave(p, true), *m = find_wave(p, false);
+
+	s.pack.magic = LEVEL_MAGIC;
+	s.pack.version = LEVEL_VERSION;
+	s.pack.count = 1;
+	s.offset = (u8 *) &s.level - (u8 *) &s.pack;
+	s.level = *level_get(p, 0);
+	s.level.win_score = 0xFFFF;
+	s.level.wave_count = 0;
+	if(e)
+		add_waves(&s.level, e, enemies);
+	if(m)
+		add_waves(&s.level, m, meteors);
+	s.level.size = sizeof(s.level) + s.level.wave_count * sizeof(struct wave);
+	return &s.pack;
+}
+
+/* Balas de la prueba: cada paso salen bullet_limit/16 desde el fondo, una por
+	columna, para que haya bullet_limit en juego */
+void stress_fire(void){
+	s8 span = lvl->max_x - lvl->min_x + 1;
+	for(u32 n = bullet_limit / 16 + 1; n--; )
+		fire_at(lvl->min_x + stress_col++ % span, lvl->bottom);
+}
+
+/* Arranca el paso stress_step: 8 enemigos, 4 meteoritos y 4 balas por 2^paso */
+void stress_ramp(void *arg){
+	if(stress_step == stress_steps){
+		stress_mode = false;
+		pack = stress_saved;
+		bullet_limit = BULLETS;
+		enter_about(0);
+		return;
+	}
+
+	u32 enemies = 8 << stress_step, meteors = 4 << stress_step, bullets = 4 << stress_step;
+	if(enemies + meteors > MAX_ENEMIES){
+		meteors = MAX_ENEMIES / 4;
+		enemies = MAX_ENEMIES - meteors;
+	}
+	bullet_limit = bullets < MAX_BULLETS ? bullets : MAX_BULLETS;
+
+	wheel_clear(&wheel);
+	pack = stress_pack(stress_saved, enemies, meteors);
+	level = 0;
+	lvl = level_get(pack, 0);
+	start_level(0);
+	stress_step++;
+	wheel_schedule(&wheel, STRESS_STEP_TIME, stress_ramp, 0);
+}
+
+void stress_start(void){
+	stress_saved = pack;
+	stress_mode = true;
+	stress_step = 0;
+	stress_ramp(0);
+}
+
+void game_init(const struct level_pack *p, const struct sprite *s, u32 count){
+	pack = p;
+	sprites = s;
+	sprite_count = count;
+	wheel_init(&wheel, 0);
+	enter_about(0);
+}
+
+/* Lo que corre dentro de wheel_advance y ya se midio (step) no se cuenta en
+	PROF_TIMERS */
+void game_advance(u32 now){
+	u64 inner = prof_inner, t = prof_begin();
+	wheel_advance(&wheel, now);
+	if (prof_enabled)
+		prof_time[PROF_TIMERS] += plat_time() - t - (prof_inner - inner);
+}
+
+u32 game_next(void){
+	return wheel.now + wheel_next(&wheel);
+}
+
+/////////// Rebobinado /////////////////
+
+/* Al empezar cada paso el estado del nivel se empaca en una imagen de bytes
+	(sin relleno ni lo que se puede deducir: oleadas, paredes fijas,
+	posiciones anteriores) y se agrega a la historia (snapshot.h), que guarda
+	solo lo que cambio. Va campo por campo y no entidad por entidad, asi los
+	campos que casi no cambian (estado, sprite, velocidades) quedan en
+	corridas largas de ceros que la diferencia salta de a 4 bytes. Todas las
+	imagenes de un nivel tienen el mismo tamano porque dependen solo de
+	wave_count, enemy_count, bullet_limit y tunnel_rows; al cambiar de nivel
+	la historia empieza de nuevo */
+
+struct snap_ring history;
+static u8 image[SNAP_MAX_IMAGE];
+
+/* Bytes de cada parte de la imagen, en el orden de pack_state() */
+#define SNAP_HEAD   (3 * 4 + 3 * 1 + 2 * 4)	// score, lives, speed; move_wall, player_safe, estado; x, y
+#define SNAP_WAVE   (1 + 3 * 4)		// active; t, ax, ay
+#define SNAP_ENEMY  (2 * 1 + 4 * 4)		// flags, i; x, y, vx, vy
+#define SNAP_BULLET (2 * 1 + 2 * 4)		// estado, x; y, vy
+#define SNAP_WALL   (2 * 1)			// x, direccion
+#define SNAP_SIZE(waves, enemies, bullets, walls) \
+	(SNAP_HEAD + (waves) * SNAP_WAVE + (enemies) * SNAP_ENEMY + \
+	 (bullets) * SNAP_BULLET + (walls) * SNAP_WALL)
+
+_Static_assert(SNAP_SIZE(MAX_WAVES, MAX_ENEMIES, MAX_BULLETS, MAX_WALL_ROWS) <= SNAP_MAX_IMAGE,
+	"SNAP_MAX_IMAGE no alcanza para el nivel mas grande");
+
+static inline u8 *put8(u8 *p, u32 v){
+	*p = v;
+	return p + 1;
+}
+
+/* Palabras de 32 bits sin alinear y en el orden de la maquina: la imagen
+	solo se lee en la misma maquina que la escribio */
+typedef u32 __attribute__((may_alias, aligned(1))) word;
+
+static inline u8 *put32(u8 *p, u32 v){
+	*(word *) p = v;
+	return p + 4;
+}
+
+static inline u32 get32(const u8 **p){
+	u32 v = *(const word *) *p;
+	*p += 4;
+	return v;
+}
+
+static inline u32 get8(const u8 **p){
+	return *(*p)++;
+}
+
+#define SNAP_ESTADO  (1 << 0)
+#define SNAP_EXPLOTA (1 << 1)
+
+static u32 pack_state(u8 *p){
+	u8 *start = p;
+	p = put32(p, score);
+	p = put32(p, lives);
+	p = put32(p, speed);
+	p = put8(p, move_wall);
+	p = put8(p, player_safe);
+	p = put8(p, player.estado);
+	p = put32(p, player.x);
+	p = put32(p, player.y);
+	for(u32 w=0; w<lvl->wave_count; w++)
+		p = put8(p, formation[w].active);
+	for(u32 w=0; w<lvl->wave_count; w++)
+		p = put32(p, formation[w].t);
+	for(u32 w=0; w<lvl->wave_count; w++)
+		p = put32(p, formation[w].ax);
+	for(u32 w=0; w<lvl->wave_count; w++)
+		p = put32(p, formation[w].ay);
+	for(u32 e=0; e<enemy_count; e++)
+		p = put8(p, (enemy[e].estado ? SNAP_ESTADO : 0) | (enemy[e].explota ? SNAP_EXPLOTA : 0));
+	for(u32 e=0; e<enemy_count; e++)
+		p = put8(p, enemy[e].i);
+	for(u32 e=0; e<enemy_count; e++)
+		p = put32(p, enemy[e].x);
+	for(u32 e=0; e<enemy_count; e++)
+		p = put32(p, enemy[e].y);
+	for(u32 e=0; e<enemy_count; e++)
+		p = put32(p, enemy[e].vx);
+	for(u32 e=0; e<enemy_count; e++)
+		p = put32(p, enemy[e].vy);
+	for(u32 b=0; b<bullet_limit; b++)
+		p = put8(p, bullet[b].estado);
+	for(u32 b=0; b<bullet_limit; b++)
+		p = put8(p, bullet[b].x);
+	for(u32 b=0; b<bullet_limit; b++)
+		p = put32(p, bullet[b].y);
+	for(u32 b=0; b<bullet_limit; b++)
+		p = put32(p, bullet[b].vy);
+	for(u8 r=0; (lvl->flags & LVF_TUNNEL) && r<lvl->tunnel_rows && r<MAX_WALL_ROWS; r++){
+		p = put8(p, wall_I[r].x);
+		p = put8(p, wall_I[r].direccion);
+	}
+	return p - start;
+}
+
+static void unpack_state(const u8 *p){
+	score = get32(&p);
+	lives = get32(&p);
+	speed = get32(&p);
+	move_wall = get8(&p);
+	player_safe = get8(&p);
+	player.estado = get8(&p);
+	player.x = player.ox = get32(&p);
+	player.y = player.oy = get32(&p);
+	for(u32 w=0; w<lvl->wave_count; w++)
+		formation[w].active = get8(&p);
+	for(u32 w=0; w<lvl->wave_count; w++)
+		formation[w].t = get32(&p);
+	for(u32 w=0; w<lvl->wave_count; w++)
+		formation[w].ax = get32(&p);
+	for(u32 w=0; w<lvl->wave_count; w++){
+		const struct wave *wv = &lvl->wave[w];
+		fixed v = fix_from88(wv->v);
+		formation[w].ay = get32(&p);
+		formation[w].vx = fix_mul(v, fix_sin(wv->angle << 8));
+		formation[w].vy = fix_mul(v, fix_cos(wv->angle << 8));
+	}
+	for(u32 e=0; e<enemy_count; e++){
+		u8 flags = get8(&p);
+		enemy[e].estado = flags & SNAP_ESTADO;
+		enemy[e].explota = flags & SNAP_EXPLOTA;
+		enemy[e].sale = false;
+	}
+	for(u32 e=0; e<enemy_count; e++)
+		enemy[e].i = get8(&p);
+	for(u32 e=0; e<enemy_count; e++)
+		enemy[e].x = enemy[e].ox = get32(&p);
+	for(u32 e=0; e<enemy_count; e++)
+		enemy[e].y = enemy[e].oy = get32(&p);
+	for(u32 e=0; e<enemy_count; e++)
+		enemy[e].vx = get32(&p);
+	for(u32 e=0; e<enemy_count; e++)
+		enemy[e].vy = get32(&p);
+	for(u32 b=0; b<bullet_limit; b++){
+		bullet[b].estado = get8(&p);
+		bullet[b].sale = false;
+	}
+	for(u32 b=0; b<bullet_limit; b++)
+		bullet[b].x = get8(&p);
+	for(u32 b=0; b<bullet_limit; b++)
+		bullet[b].y = bullet[b].oy = get32(&p);
+	for(u32 b=0; b<bullet_limit; b++)
+		bullet[b].vy = get32(&p);
+	for(u8 r=0; (lvl->flags & LVF_TUNNEL) && r<lvl->tunnel_rows && r<MAX_WALL_ROWS; r++){
+		wall_I[r].x = get8(&p);
+		wall_I[r].direccion = get8(&p);
+		wall_D[r].x = wall_I[r].x + lvl->tunnel_gap;
+	}
+}
+
+void snapshot_start(void){
+	snap_reset(&history, image, pack_state(image));
+}
+
+void snapshot_save(void){
+	u64 t = prof_begin();
+	pack_state(image);
+	snap_push(&history, image);
+	prof_lap(PROF_SNAPSHOT, t);
+}
+
+/* Vuelve REWIND_STEPS pasos atras. Los temporizadores no estan en la imagen:
+	se vuelven a programar segun el estado (los enemigos que no estan salen
+	despues de su respawn_ms, las explosiones terminan y la invulnerabilidad
+	se acaba despues de su tiempo completo) */
+void rewind_state(void){
+	if(!snap_rewind(&history, REWIND_STEPS))
+		return;
+	unpack_state(history.last);
+	particles.count = 0;
+
+	wheel_clear(&wheel);
+	for(u32 e=0; e<enemy_count; e++){
+		if(enemy[e].explota)
+			wheel_schedule(&wheel, CLEAR_DELAY, clear_enemy, (void *) (uptr) e);
+		else if(!enemy[e].estado && !lvl->wave[enemy[e].wave].path)
+			wheel_schedule(&wheel, lvl->wave[enemy[e].wave].respawn_ms, release_enemy, (void *) (uptr) e);
+	}
+	for(u32 w=0; w<lvl->wave_count; w++)
+		if(lvl->wave[w].path && !formation[w].active)
+			wheel_schedule(&wheel, lvl->wave[w].respawn_ms, release_formation, (void *) (uptr) w);
+	if(player_safe)
+		wheel_schedule(&wheel, INVULNERABLE_TIME, end_safe, 0);
+	wheel_schedule(&wheel, speed, step, 0);
+	wheel_schedule(&wheel, PARTICLE_TICK, effects_step, 0);
+	hold_start();
+	dirty = true;
+}
@@ -0,0 +1,196 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include "types.h"
+#include "level.h"
+#include "asset.h"
+#include "fixed.h"
+#include "snapshot.h"
+
+/* Nucleo del juego: estado, reglas y temporizadores, sin nada de hardware.
+   El kernel le pasa el tiempo y las entradas y pinta su estado; en Linux se
+   compila como biblioteca (libgame.a) para medirlo con bench.c. Lo unico que
+   necesita de la plataforma esta en platform.h */
+
+#define MAX_BULLETS   (1024)
+#define MAX_ENEMIES   (4096)
+#define MAX_WALL_ROWS (25)
+
+/* Las filas van en punto fijo (celdas) para que las velocidades puedan ser
+   fracciones de celda por paso. oy es la fila donde estaba despues de la
+   ultima revision de colisiones: el tramo de oy a y es lo que recorrio y se
+   revisa completo, asi nada atraviesa a nada aunque avance varias celdas */
+
+/* Estructura para informacion de naves (Player y enemigos)*/
+struct ship_inf{ 
+	u8 i;    		// Escoger que sprite pintar, Enemigo, meteorito o player.
+	bool estado;	// Estado de la nave (presente o no), bool ya que va a cont T o F
+	bool explota;	// Recibio un disparo y se muestra la explosion hasta que se limpie
+	u8 wave, member;	// Oleada del nivel a la que pertenece y su posicion en ella
+	bool sale;		// Paso el fondo; sale del juego despues de revisar colisiones
+	fixed x, y;		// Posicion en unidades del nivel, con fraccion
+	fixed ox, oy;		// Posicion al empezar el paso
+	fixed vx, vy;		// Unidades por paso
+};
+
+/* Enemigos de cada oleada del nivel: enemy[first .. first + count). Las
+   oleadas con trayectoria (level.h) son formaciones y ademas llevan el ancla
+   y el paso de la trayectoria; todas sus posiciones salen de ahi */
+struct formation{
+	u16 first, count;
+	bool active;		// en vuelo; si no, esperando volver a salir
+	u32 t;			// pasos desde que salio
+	fixed ax, ay;		// lo que avanzo el ancla desde x0, y0
+	fixed vx, vy;		// por paso
+};
+
+/* Se usa una logica parecida a la nave pero para LA BALA */
+
+struct bullet_ship{
+	s8 x; //solo hay movimiento en y y x para ubicar
+	bool estado; // si bala existe o no existe
+	bool sale;	// llego arriba; sale despues de revisar colisiones
+	fixed y, oy, vy;
+};
+
+
+struct wall_loc{
+	s8 x, y;
+	bool direccion;
+};
+
+/* Pantallas del juego */
+enum screen{
+	SCREEN_ABOUT,
+	SCREEN_PLAY,
+	SCREEN_BANNER,
+	SCREEN_GAMEOVER,
+	SCREEN_WIN
+};
+
+/* Entradas del jugador; la plataforma traduce sus teclas a estas */
+enum input{
+	INPUT_NONE,
+	INPUT_LEFT,
+	INPUT_RIGHT,
+	INPUT_FIRE,
+	INPUT_START,
+	INPUT_REWIND	// vuelve REWIND_STEPS pasos atras
+};
+
+/* Subsistemas que mide el perfilador */
+enum prof_id{
+	PROF_BULLETS,
+	PROF_ENEMIES,
+	PROF_WALLS,
+	PROF_SPAWN,
+	PROF_COLLIDE,
+	PROF_PARTICLES,
+	PROF_SNAPSHOT,	// empacar el estado y guardar su diferencia
+	PROF_TIMERS,	// callbacks de la rueda, sin contar los pasos ni particulas
+	PROF_COUNT
+};
+
+/* Sonidos que pide el juego, de menor a mayor prioridad. Cada paso deja en
+   sounds un bit por cada uno (1 << sound) y la plataforma los toca y limpia */
+enum sound{
+	SOUND_SHOT,
+	SOUND_HIT,
+	SOUND_CRASH,	// se perdio una vida
+	SOUND_LEVEL,
+	SOUND_GAMEOVER,
+	SOUND_WIN,
+	SOUND_COUNT
+};
+
+extern u32 sounds;
+
+/* Tabla de records, de mayor a menor puntaje. Cabe en un sector y la
+   plataforma la guarda tal cual (ver kernel.c) */
+#define HISCORES (8)
+#define HISCORE_MAGIC (0x45524353) // "SCRE"
+
+struct hiscore{
+	u32 score;
+	u32 level;	// nivel al que se llego (desde 1)
+};
+
+struct hiscore_table{
+	u32 magic;
+	u32 count;
+	struct hiscore entry[HISCORES];
+	u32 sum;	// asset_sum() de todo lo anterior
+};
+
+extern struct hiscore_table hiscores;
+extern bool hiscores_dirty;	// cambio desde que la plataforma la guardo
+
+/* Toma la tabla de p si es valida; retorna false (y la deja vacia) si no */
+bool hiscores_load(const void *p);
+
+extern struct ship_inf player;
+extern struct bullet_ship bullet[MAX_BULLETS];
+extern u32 bullet_limit;	// balas que se usan (BULLETS salvo en la prueba de carga)
+extern struct ship_inf enemy[MAX_ENEMIES];
+extern u32 enemy_count;
+extern struct formation formation[MAX_WAVES];
+extern struct wall_loc wall_I[MAX_WALL_ROWS];
+extern struct wall_loc wall_D[MAX_WALL_ROWS];
+extern s8 move_wall;
+extern bool player_safe;
+extern u32 speed, score, lives, level;
+extern u32 level_score;	// puntaje al empezar el nivel
+extern struct snap_ring history;	// estados del nivel para rebobinar
+
+extern const struct level_pack *pack;
+extern const struct level *lvl;
+extern const struct sprite *sprites;
+extern u32 sprite_count;
+
+extern enum screen screen;	// Pantalla actual
+extern bool dirty;		// Hay cambios que publicar
+
+/* Con prof_enabled cada subsistema suma su tiempo en prof_time; prof_steps
+   cuenta los pasos del juego */
+extern bool prof_enabled;
+extern u64 prof_time[PROF_COUNT];
+extern u32 prof_steps;
+
+/* Arranca en la portada con los niveles y sprites dados (ya validados) */
+void game_init(const struct level_pack *p, const struct sprite *s, u32 count);
+
+void game_input(enum input in);
+
+/* La plataforma avisa con game_key cuando se aprieta (down) y se suelta cada
+   entrada. Apretar es un game_input(); mientras izquierda o derecha sigan
+   apretadas la nave se mueve cada move_tick ms (MOVE_TICK por omision) */
+void game_key(enum input in, bool down);
+extern u32 move_tick;
+
+/* Procesa los temporizadores hasta now (ms desde game_init) */
+void game_advance(u32 now);
+
+/* Colisiones y fin de nivel; se llama despues de publicar cada cambio */
+void game_check(void);
+
+/* ms (en la misma escala que game_advance) del siguiente evento programado */
+u32 game_next(void);
+
+/* Prueba de carga: desde la portada juega stress_steps pasos de
+   STRESS_STEP_TIME ms, duplicando en cada uno enemigos, meteoritos y balas, y
+   vuelve a la portada. stress_step es el paso actual (desde 1) */
+extern bool stress_mode;
+extern u32 stress_step;
+extern u32 stress_steps;	// STRESS_STEPS salvo que la plataforma diga otra cosa
+
+/* Duracion del paso en % de la que dice el nivel (TICK_SCALE); la
+   plataforma la cambia antes de game_init */
+extern u32 tick_scale;
+
+void stress_start(void);
+
+/* Un nivel (el unico de lo que retorna) con la geometria del primero de p y
+   la cantidad dada de enemigos y meteoritos */
+const struct level_pack *stress_pack(const struct level_pack *p, u32 enemies, u32 meteors);
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef IO_H
+#define IO_H
+
+#include "types.h"
+
+/* Port I/O */
+
+/* Las instrucciones son volatile para que el compilador no elimine ni agrupe
+   lecturas repetidas de un mismo puerto cuando se optimiza */
+
+static inline u8 inb(u16 p){
+	u8 r;
+	asm volatile("inb %1, %0" : "=a" (r) : "dN" (p));
+	return r;
+}
+
+static inline void outb (u16 p, u8 d){
+	asm volatile("outb %1, %0" : : "dN" (p), "a" (d));
+}
+
+static inline u16 inw(u16 p){
+	u16 r;
+	asm volatile("inw %1, %0" : "=a" (r) : "dN" (p));
+	return r;
+}
+
+static inline void outw(u16 p, u16 d){
+	asm volatile("outw %1, %0" : : "dN" (p), "a" (d));
+}
+
+/* Timing */
+
+/*Devuelve el # de ticks de la CPU desde el inicio */
+static inline u64 rdtsc(void){
+	u32 hi, lo;
+	asm volatile("rdtsc" : "=a" (lo), "=d" (hi));
+	return ((u64) lo) | (((u64) hi) << 32);
+}
+
+/* Pista al procesador de que estamos en un ciclo de espera activa */
+static inline void cpu_relax(void){
+	asm volatile("pause" : : : "memory");
+}
+
+#endif
@@ -0,0 +1,129 @@
+#include "types.h"
+#include "io.h"
+#include "serial.h"
+#include "irq.h"
+
+#define PIC1_CMD  (0x20)
+#define PIC1_DATA (0x21)
+#define PIC2_CMD  (0xA0)
+#define PIC2_DATA (0xA1)
+#define PIC_EOI   (0x20)
+
+#define PIT_CH0 (0x40)
+#define PIT_CMD (0x43)
+#define PIT_HZ  (1193182)
+
+/* Entradas en isr.S */
+void isr_timer(void);
+void isr_spurious(void);
+void isr_exceptions(void);
+
+#define ISR_EXC_SIZE (16)	// bytes de cada entrada de isr_exceptions
+
+struct idt_entry{
+	u16 offset_lo;
+	u16 selector;
+	u8 zero;
+	u8 type;
+	u16 offset_hi;
+} __attribute__((packed));
+
+static struct idt_entry idt[256];
+
+static struct{
+	u16 limit;
+	u32 base;
+} __attribute__((packed)) idt_ptr = {sizeof(idt) - 1, (u32) idt};
+
+void (*irq_timer)(void);
+volatile u32 irq_count, irq_cycles;
+
+/* Compuerta de interrupcion de anillo 0 en el segmento de codigo de boot.S */
+static void set_gate(u8 vector, void (*handler)(void)){
+	u32 a = (u32) handler;
+	idt[vector] = (struct idt_entry) {a, 0x08, 0, 0x8E, a >> 16};
+}
+
+/* Lo llama isr_timer con los registros ya guardados */
+void irq_timer_handler(void){
+	u32 t = rdtsc();
+	if (irq_timer)
+		irq_timer();
+	outb(PIC1_CMD, PIC_EOI);
+	irq_count++;
+	irq_cycles += (u32) rdtsc() - t;
+}
+
+/* Lo que isr_exception deja en la pila: pushal, el vector, el codigo de
+   error (o 0) y lo que empujo el CPU */
+struct exception_frame{
+	u32 edi, esi, ebp, esp, ebx, edx, ecx, eax;
+	u32 vector, error;
+	u32 eip, cs, eflags;
+};
+
+static char *append_hex(char *p, u32 v){
+	for (s32 s = 28; s >= 0; s -= 4)
+		*p++ = "0123456789ABCDEF"[(v >> s) & 0xF];
+	return p;
+}
+
+/* Una excepcion es un error del kernel: se avisa por el puerto serie y el
+   nucleo queda detenido (antes la falta sin compuerta reiniciaba la maquina
+   sin decir nada) */
+void irq_exception_handler(const struct exception_frame *f){
+	char line[64], *p = line;
+	const char *s;
+	for (s = "excepcion "; *s; s++)
+		*p++ = *s;
+	p = append_hex(p, f->vector << 24) - 6;	// solo dos digitos
+	for (s = " eip="; *s; s++)
+		*p++ = *s;
+	p = append_hex(p, f->eip);
+	for (s = " error="; *s; s++)
+		*p++ = *s;
+	p = append_hex(p, f->error);
+	*p++ = '\r';
+	*p++ = '\n';
+	*p = 0;
+	serial_puts(line);
+	while (!serial_flush())
+		;
+	while (true)
+		asm volatile("cli; hlt");
+}
+
+void irq_load_idt(void){
+	asm volatile("lidt %0" : : "m" (idt_ptr));
+}
+
+void irq_init(void){
+	/* Excepciones a isr_exceptions. IRQ7 es la espuria del PIC maestro y
+	   la del APIC local va a IRQ_LAPIC_SPURIOUS (smp.c); ninguna lleva EOI */
+	for (u32 v = 0; v < 32; v++)
+		set_gate(v, (void (*)(void)) ((u32) isr_exceptions + v * ISR_EXC_SIZE));
+	set_gate(IRQ_BASE + 0, isr_timer);
+	set_gate(IRQ_BASE + 7, isr_spurious);
+	set_gate(IRQ_LAPIC_SPURIOUS, isr_spurious);
+	irq_load_idt();
+
+	/* ICW1-4: en cascada, vectores IRQ_BASE y IRQ_BASE + 8, modo 8086 */
+	outb(PIC1_CMD, 0x11);
+	outb(PIC2_CMD, 0x11);
+	outb(PIC1_DATA, IRQ_BASE);
+	outb(PIC2_DATA, IRQ_BASE + 8);
+	outb(PIC1_DATA, 1 << 2);
+	outb(PIC2_DATA, 2);
+	outb(PIC1_DATA, 0x01);
+	outb(PIC2_DATA, 0x01);
+	outb(PIC1_DATA, ~1);	// solo IRQ0
+	outb(PIC2_DATA, 0xFF);
+
+	/* Canal 0, byte bajo y alto, modo 2 (generador de tasa) */
+	u16 div = PIT_HZ / IRQ_HZ;
+	outb(PIT_CMD, 0x34);
+	outb(PIT_CH0, div);
+	outb(PIT_CH0, div >> 8);
+
+	asm volatile("sti");
+}
@@ -0,0 +1,44 @@
+#ifndef IRQ_H
+#define IRQ_H
+
+#include "types.h"
+
+/* Interrupciones del BSP: IDT, el PIC 8259 remapeado a IRQ_BASE y el canal 0
+   del PIT dando IRQ0 IRQ_HZ veces por segundo. Es la unica que se habilita:
+   teclado y disco se siguen consultando. El AP no recibe ninguna (su LINT0
+   queda enmascarado), asi que el renderizado nunca se interrumpe */
+
+#define IRQ_BASE (0x20)
+#define IRQ_HZ (1000)
+
+/* Vector de las interrupciones espurias del APIC local (registro SVR) */
+#define IRQ_LAPIC_SPURIOUS (0xFF)
+
+/* Se llama en cada tick con las interrupciones deshabilitadas; tiene que
+   ser corto y no puede ceder el procesador */
+extern void (*irq_timer)(void);
+
+/* Ticks atendidos y ciclos del TSC dentro del manejador. Son de 32 bits para
+   leerlos sin deshabilitar interrupciones; las diferencias dan vuelta bien */
+extern volatile u32 irq_count, irq_cycles;
+
+/* Carga la IDT, programa PIC y PIT y habilita las interrupciones. Las
+   excepciones del CPU se informan por el puerto serie y detienen el nucleo */
+void irq_init(void);
+
+/* Carga la misma IDT en un AP; con sus interrupciones deshabilitadas solo
+   le sirve para las excepciones */
+void irq_load_idt(void);
+
+/* Secciones criticas contra el manejador en el mismo nucleo */
+static inline u32 irq_save(void){
+	u32 flags;
+	asm volatile("pushfl; popl %0; cli" : "=r" (flags) : : "memory");
+	return flags;
+}
+
+static inline void irq_restore(u32 flags){
+	asm volatile("pushl %0; popfl" : : "r" (flags) : "memory", "cc");
+}
+
+#endif
@@ -1,40 +1,25 @@
 #include "config.h" //incluye el archivo cabecera con las diferentes variables ya declaradas
-
-typedef unsigned char       u8;  //varable de 8 bits sin bit reservado para signo
-typedef signed char         s8;  //varable con bit reservado para signo
-typedef unsigned short      u16; //Variable de 16 bits sin signo
-typedef signed short        s16; 
-typedef unsigned int        u32;
-typedef signed int          s32;
-typedef unsigned long long  u64; // Variable de 64 bits sin bit de signo
-typedef signed long long    s64;
-
-#define noreturn __attribute__((noreturn)) void
-
-typedef enum bool {
-	false,
-	true
-}bool;
-
-//Algoritmo exponencial con la funcion "pow()"
-static inline double pow(double a, double b){ // a elevado a b
-	double result = 1;
-	while(b-- > 0)
-		result *= a;
-	return result;
-}
-
-/* Port I/O */
-
-static inline u8 inb(u16 p){
-	u8 r;
-	asm("inb %1, %0" : "=a" (r) : "dN" (p));
-	return r;
-}
-
-static inline void outb (u16 p, u8 d){
-	asm("outb %1, %0" : : "dN" (p), "a" (d));
-}
+#include "types.h"
+#include "io.h"
+#include "smp.h"
+#include "tribuf.h"
+#include "mem.h"
+#include "clock.h"
+#include "sched.h"
+#include "serial.h"
+#include "ps2.h"
+#include "ata.h"
+#include "bcache.h"
+#include "irq.h"
+#include "sound.h"
+#include "level.h"
+#include "multiboot.h"
+#include "settings.h"
+#include "asset.h"
+#include "platform.h"
+#include "fixed.h"
+#include "particle.h"
+#include "game.h"
 
 /* Divide por 0(en un bucle para satisfacer el atributo de noreturn) para activar
 una division por cero ISR, que no se controla y provoca un restablecimiento completo*/
@@ -45,92 +30,6 @@ noreturn reset (void){
 		one /= zero;
 }
 
-/* Timing */
-
-/*Devuelve el # de ticks de la CPU desde el inicio */
-static inline u64 rdtsc(void){
-	u32 hi, lo;
-	asm("rdtsc" : "=a" (lo), "=d" (hi));
-	return ((u64) lo) | (((u64) hi) << 32);
-}
-
-/* Devuelve el segundo campo enemigo[lyd] de el tiempo real del reloj (RTC)
-	Tenga en cuenta que el valor puede o no estar representado de tal manera que
-	debe formatearse en hexadecimal para mostrar al segundo enemigo[lyd]
-	(Es decir, 0x30 para el segundo 30) */
-
-u8 rtcs(void){
-	u8 last = 0, sec;
-	do { /* Hasta que el valor sea el mismo 2 veces*/
-		/*Esperar a que la actualizacion no este en curso*/
-		do{ 
-			outb(0x70, 0x0A); 
-		} while (inb(0x71) & 0x80);
-		outb(0x70, 0x00);
-		sec = inb(0x71); 
-	}while (sec != last && (last = sec) );
-	return sec;
-}
-
-/* EL numero de ticks de CPU por milisegundos */
-u64 tpms;
-
-/* Establezca el numeros de ticks por milisegundos del CPU basado en el numero de
-	ticks en el ultimo segundo, si el segundo ha cambiado desde la ultima llamada.
-	Esto se llama en cada iteracion del bucle principal para proporcionar una 
-	sincronizacion precisa*/
-
-void tps (void){
-
-	static u64 ti = 0;
-	static u8 last_sec= 0xFF;
-	u8 sec= rtcs();
-	if (sec != last_sec){
-		last_sec = sec;
-		u64 tf = rdtsc();
-		tpms = (u32) ((tf - ti) >> 3) / 125; //Menos posibilidades de truncamiento
-		ti = tf;
-	}
-}
-
-/* IDs utilizados para mantener separados los tiempos de operacion*/
-enum timer{
-	TIMER_UPDATE,
-	TIMER_CLEAR,
-	TIMER_LENGTH
-};
-
-u64 timers[TIMER_LENGTH] = {0};
-
-/*Retorna TRUE si han transcurrido al menos ms desde la ultima llamada
-  que retorno TRUE para este temporizador. Cuando se llama en iteracion
-  del bucle principal, tiene el efecto de devolver TRUE una vez cada milisegundo*/
-bool interval (enum timer timer, u32 ms){
-	u64 tf = rdtsc();
-	if (tf - timers[timer] >= tpms * ms){
-		timers[timer] = tf;
-		return true;
-	}
-	else return false;
-}
-
-/* Retorna verdadero si han transcurrido al menos ms dede la primera llamada
-	para este temporizador y reinicia el temporizador*/
-
-bool wait(enum timer timer, u32 ms){
-	if (timers[timer]){
-		if (rdtsc() - timers [timer >= tpms * ms]) {
-			timers[timer] = 0;
-			return true;
-		}
-		else return false;
-	}
-	else{
-		timers[timer] = rdtsc();
-		return false;
-	}
-}
-
 /* Video Output */
 
 /* 7 posibles colores de visualizacion, se pueden hacer tonos mas brillantes
@@ -152,12 +51,44 @@ enum color { // variable que define todos los posibles valores que pueda contene
 #define ROWS (25) // eje y
 u16 *const video = (u16*) 0xB8000;
 
+/* Todo se pinta primero en este buffer y present() lo copia completo a la
+   memoria de video, asi nunca se ve un cuadro a medio pintar */
+u16 back_buffer[ROWS * COLS];
+
 /* Muestra un caracter en x, y en color de primer plano fg(foreground) y color
    de fondo bg(background).*/
 
 void putc(u8 x, u8 y, enum color fg, enum color bg, char c){
 	u16 z= (bg << 12) | (fg << 8) | c;  // recordand que << es un desplazamiento y | es or
-	video[y * COLS + x] = z;
+	back_buffer[y * COLS + x] = z;
+}
+
+/* Pinta c encima de lo que haya en x, y: deja el fondo y suma (con or) fg al
+	color de texto de la celda, asi donde se juntan varias particulas brilla
+	mas y no importa en que orden se pinten */
+
+static inline void blend(u8 x, u8 y, u8 fg, char c){
+	u16 *cell = &back_buffer[y * COLS + x];
+	*cell = (*cell & 0xFF00) | (fg << 8) | (u8) c;
+}
+
+/* Espera a que empiece el retrazado vertical (bit 3 del estado de entrada 1
+	de la VGA), cediendo el procesador mientras tanto */
+
+void wait_retrace(void){
+	while (inb(0x3DA) & 0x08)
+		task_yield();
+	while (!(inb(0x3DA) & 0x08))
+		task_yield();
+}
+
+/* Copia el buffer de atras a la pantalla */
+
+void present(void){
+	u32 *src = (u32 *) back_buffer;
+	u32 *dst = (u32 *) video;
+	for (u32 i = 0; i < ROWS * COLS / 2; i++)
+		dst[i] = src[i];
 }
 
 /* Muestra una cadena que comienza en "x", "y" en color fb y bg. Los caracteres
@@ -184,38 +115,26 @@ void clear (enum color bg){
 
 
 
+/* Textos del juego, usados directamente desde el archivo de recursos (ver
+	asset.h). Los niveles y sprites los tiene el nucleo del juego (game.h) */
+const struct string_table *strings;
+const struct text_item *about;
+u32 about_count;
+
+#define STR(id) string_get(strings, id)
+
+
 /* Dibuja en pantalla la informacion general (Portada del juego)*/
 
 /* #define TITLE_X (COLS/ 2 - 9)
 	#define TITLE_Y (ROWS/ 2 - 10)*/
 
+/* Los textos y su ubicacion salen del registro "about" (ver text.S) */
+
 void draw_about(void){ 
 	//puts(u8 x, u8 y, enum color fg, enum color bg, const char *s)  
-
-	/*Dibuja parte superior de portada LEAD*/
-	puts(34, 3, BLACK, BLUE, "            ");
-	puts(34, 4, BLACK, BLUE, " ");
-	puts(45, 4, BLACK, BLUE, " ");
-	puts(34, 5, BLACK, BLUE, " ");
-	puts(45, 5, BLACK, BLUE, " ");
-	puts(35, 5, GRAY, BLACK, "   LEAD   ");
-	puts(34, 6, BLACK, BLUE, " ");
-	puts(45, 6, BLACK, BLUE, " ");
-	puts(34, 7, BLACK, BLUE, "            ");
-
-	/*Informacion de portada*/
-	puts(4, 14, GRAY, BLACK, "Instituto Tecnologico de Costa Rica");
-	puts(4, 16, GRAY, BLACK, "SO Empotrados");
-	puts(4, 18, GRAY, BLACK, "Jose Andrey Sequeira Ruiz");
-	puts(4, 20, GRAY, BLACK, "Profesor: Ernesto Rivera");
-
-	/*Dibuja Nave en portada*/
-
-	
-	/*puts(61, 17, BLACK, BLUE,    "   ");
-	puts(58, 18, BLACK, BLUE, "         ");*/
-
-	puts(49, 20, BRIGHT|GREEN, BLACK, "Presione ENTER para continuar");
+	for (u32 i = 0; i < about_count; i++)
+		puts(about[i].x, about[i].y, about[i].fg, about[i].bg, STR(about[i].str));
 }
 
 
@@ -226,17 +145,28 @@ void draw_about(void){
 #define KEY_RIGHT (0x4D) // for moving right
 #define KEY_ENTER (0x1C) // for enter game
 #define KEY_SPACE (0x39) // for shooting
+#define KEY_BACKSPACE (0x0E) // rebobinar
+#define KEY_F2    (0x3C) // registro de cuadros largos
 
-/* Devuelve el codigo de escaneo de la tecla actual, si ha cambiado desde l ultima llamada
-	de lo contrarioi devuelve 0. Cuando se llama en cada iteracion del bucle principal devuelve
-	un valor distinto de cero en un evento de tecla*/
+/* Estado de cada tecla (codigo del set 1 sin el bit de soltar). Con el se
+	descartan las repeticiones del teclado: solo cuenta cuando cambia */
+bool key_down[128];
 
-u8 scan (void){
-	static u8 key = 0;
-	u8 scan = inb(0x60); 	// Entrada para lectura del teclado
-	if (scan != key) 			// Si es diferente de 0 se presiona tecla
-		return key = scan;	// Por lo que retorna el valor de la tecla presionada
-	else return 0;
+/* Lee un byte del teclado y si es un cambio de tecla deja su codigo en *key
+	y en *down si se apreto. Retorna false si no hay byte o no es un cambio.
+	Los prefijos de teclas extendidas (0xE0, 0xE1) se saltan: las flechas
+	dan el mismo codigo con o sin el */
+
+bool scan(u8 *key, bool *down){
+	u8 b;
+	if (!ps2_read(&b) || b == 0xE0 || b == 0xE1 || b == 0x00 || b == 0xFA || b >= 0xFE)
+		return false;
+	*key = b & 0x7F;
+	*down = !(b & 0x80);
+	if (key_down[*key] == *down)
+		return false;
+	key_down[*key] = *down;
+	return true;
 }
 
 /* Formateo */
@@ -256,797 +186,1216 @@ char *itoa(u32 n, u8 r, u8 w){
 	return (char *) (s+i);
 }
 
-/*Random*/
+/* Escribe n en base 10 en buf sin ancho fijo y retorna el final de la cadena.
+	A diferencia de itoa no usa un buffer estatico, asi que se puede usar fuera
+	del renderizador */
 
-/* Genera un # aleatorio de 0 inclusivo a un rango exclusivo del numero
-	de ticks del CPU desde el inicio*/
-u32 rand(u32 range){
-	return (u32) rdtsc() % range;
+char *utoa(char *buf, u32 n){
+	char t[10];
+	u8 i=0;
+	do{
+		t[i++]='0' + n % 10;
+		n /= 10;
+	} while (n);
+	while (i)
+		*buf++ = t[--i];
+	*buf=0;
+	return buf;
 }
 
-/* Mezcla una matriz de bytes (arr) de longitud (len) en lugar usando Fisher- Yates*/
-
-void shuffle(u8 arr[], u32 len){
-	u32 i, j;
-	u8 t;
-	for (i= len-1; i>0; i--){
-		j = rand(i+1);
-		t=arr[i];
-		arr[i]= arr[j];
-		arr[j]=t;
-	}
+/* Columna de pantalla de la unidad x del nivel */
+static inline u8 col(const struct level *l, s8 x){
+	return l->x0 + x * l->xscale;
 }
 
-/* Para creacion de naves (enemigos y jugador)*/
-
-u8 ships[5][2][3] = {
-	/*Los numeros de estas listas estan relacionados segun el #color de "num color"*/
- 	{ //Nave jugador Azul
-
- 		{0,1,0}, 
- 		{1,1,1}
- 	},
- 	{ //Enemigo color rojo
- 		{4,0,4},
- 		{0,4,0}
- 	},
- 	{ //Enemigo color CYAN
- 		{3,0,3},
- 		{0,3,0}
- 	},
- 	{ //Enemigo color amarillo
- 		{6,0,6},
- 		{0,6,0}
- 	},
- 	{ //Enemigo color verde
- 		{2,0,2},
- 		{0,2,0}
- 	}
-};
-
-u8 meteo[1][1][2] = {
-	{
-		{6,6}
-	}
-};
-
+/*#define STATUS_X (COLS * 3/4)
+#define STATUS_Y (ROWS /2 -4)*/
 
-// 			puts(WELL_X+player.x * 2 + x*2, player.y + y, YELLOW, ships[player.i][y][x], "#");
-// x=0 y=0;				18 + 22 + 0*2 = 40, 	11+0=11,				Y,			ships[0][0][0]
-// x=1 y=0;       	18 + 22 + 1*2 = 42, 	   11+0=,				Y,			ships[0][0][0]  
+#define SCORE_X (COLS/2 - 4)
+#define SCORE_Y (ROWS-2)
 
+#define LIVES_X (3)
+#define LIVES_Y (SCORE_Y-2)
 
-/* Estructura para informacion de naves (Player y enemigos)*/
-struct ship_inf{ 
-	u8 i;    		// Escoger que nave pintar, Enemigo o player.
-	s8 x, y; 		// Posicion de la nave
-	bool estado;	// Estado de la nave (presente o no), bool ya que va a cont T o F
+/* Copia del estado del juego que necesita el renderizador para pintar un cuadro.
+   La simulacion la llena y la publica en el triple buffer; el renderizador
+   (en otro nucleo si lo hay) solo lee su copia y nunca toca los globales. El
+   nivel se comparte por puntero porque nunca cambia */
+struct frame{
+	enum screen screen;
+	const struct level *lvl;
+	u32 level;
+	struct ship_inf player;
+	u32 bullet_count;
+	struct bullet_ship bullet[MAX_BULLETS];
+	u32 enemy_count;
+	struct ship_inf enemy[MAX_ENEMIES];
+	struct wall_loc wall_I[MAX_WALL_ROWS];
+	struct wall_loc wall_D[MAX_WALL_ROWS];
+	u32 particle_count;
+	struct{
+		u8 x, y;	// celda de pantalla
+		char glyph;
+		u8 color;
+	} particle[MAX_PARTICLES];
+	s8 move_wall;
+	bool player_safe;
+	u32 score, lives;
+	u8 ncpu;
+	u8 load[MAX_CPUS];
+	struct hiscore_table hiscores;
+	u32 input_seq;		// ultimo evento de entrada que ya se ve en el cuadro
+	u64 input_t, consume_t;	// TSC al leerlo del teclado y despues del paso que lo uso
 };
 
-/* Se usa una logica parecida a la nave pero para LA BALA */
+struct frame frames[3];
+struct tribuf frame_tb;
+
+/* Pinta un sprite con su esquina superior izquierda en la unidad x, fila y */
+
+void draw_sprite(const struct level *l, s8 x, s8 y, const struct sprite *sp, enum color ink){
+	char c[2] = {0, 0};
+	for(u8 yy=0; yy<sp->h; yy++){
+		c[0] = sp->glyph[yy];
+		for(u8 xx=0; xx<sp->w; xx++){
+			u8 color = sp->color[yy][xx];
+			if(!color)
+				continue;
+			if(sp->mode == SPRITE_FILL)
+				puts(col(l, x + xx), y + yy, ink, color, c);
+			else
+				puts(col(l, x + xx), y + yy, color | ink, BLACK, c);
+		}
+	}
+}
 
-struct bullet_ship{
-	s8 x, y; //solo hay movimiento en y y x para ubicar
-	bool estado; // si bala existe o no existe
-};
+/*Ahora creamos una funcion que permita dibujar los componentes del juego*/
 
-struct meteorite{
-	u8 i;
-	s8 x, y;
-	bool estado;
-};
+/* Sin effects (renderizado degradado) no se anima la pared ni se pintan las
+	explosiones */
 
+void draw(const struct frame *f, bool effects){
+	const struct level *l = f->lvl;
+	clear(BLACK);
+	u8 x, y;
 
-struct wall_loc{
-	s8 x, y;
-	bool direccion;
-};
+	/* Pintar los bordes del area dejuego */
 
-struct wall_loc wall_I[18];
-struct wall_loc wall_D[18];
+	if(l->flags & LVF_WELL){
+		u8 left = col(l, 0) - 1, right = col(l, l->well_width);
 
+		for (y=2; y<l->bottom; y++){
+			putc(left, y, BLACK, GRAY, ' '); //Pared izquierda
+			putc(right, y, BLACK, GRAY, ' '); //Pared Derecha
+		}
 
-struct ship_inf player; /* Hacemos que jugador sea una estructura conformada por la estructura ship_inf*/
-struct bullet_ship bullet[5]; // un array para que se puedan disparar solo 5 balas seguidas.
-struct meteorite met[3];
+		// Para crear efecto de movimiento en las paredes//
+		for (y=f->move_wall; effects && y<l->bottom; y+=2){
+			putc(left, y, GRAY, BLACK, ' '); //Pared izquierda
+			putc(right, y, GRAY, BLACK, ' '); //Pared Derecha
+		}
+	}
 
-#define REFER_MAX  (31) //(COLS/2 - WELL_WIDTH2) 
-#define REFER_MIN  (21) //(REFER_MAX-10)	        
+////// Para movimiento de paredes del tunel ///////
+	if(l->flags & LVF_TUNNEL){
+		for(x=0; x<l->tunnel_rows && x<MAX_WALL_ROWS; x++){
+			putc(col(l, f->wall_I[x].x), f->wall_I[x].y, BLACK, GRAY, ' ');
+			putc(col(l, f->wall_D[x].x), f->wall_D[x].y, BLACK, GRAY, ' ');
+		}
+	}
 
-#define REFER_MAXD  (59)//(COLS/2 + WELL_WIDTH2) //54
-#define REFER_MIND  (49)//(REFER_MAXD - 10)      //44 49
+	/*Se corrobora el estado de la nave*/
+	if(f->player.estado == true)
+		draw_sprite(l, fix_int(f->player.x), fix_int(f->player.y), &sprites[f->player.i], f->player_safe ? GRAY : sprites[f->player.i].ink);
 
-s8 posicion_x= REFER_MAX;
-s8 posicion_xD= REFER_MAXD;
+	/* Codigo para el pintado de la bala, misma logica del movimiento del jugador*/
 
+	for(u32 bb = 0; bb < f->bullet_count; bb++){
+		if(f->bullet[bb].estado == true)
+			puts(col(l, f->bullet[bb].x), fix_int(f->bullet[bb].y), GRAY, BLACK, "|");
+	}
 
-/* Pueba con un solo enemigo, primero se prueba con un solo enemigo para ver el correcto funcionamiento y luego
-	cambiamos el codigo para que sean varios enemigos*/
-struct ship_inf enemy[4];
+	for(u32 ee=0; ee<f->enemy_count; ee++){
+		const struct ship_inf *e = &f->enemy[ee];
+		const struct sprite *sp = &sprites[e->i];
+		if(e->estado != true)
+			continue;
+		if(e->explota){
+			if(!effects)
+				continue;
+			for(y=0; y < sp->h; y++)
+				for(x=0; x < sp->w; x++)
+					puts(col(l, fix_int(e->x) + x), fix_int(e->y) + y, BRIGHT|YELLOW, BLACK, "*");
+		}
+		else
+			draw_sprite(l, fix_int(e->x), fix_int(e->y), sp, sp->ink);
+	}
 
-u32 speed= INITIAL_SPEED, score=0, lives=4, level=1;
+	/* Particulas, encima de todo lo demas */
+	for(u32 i=0; effects && i<f->particle_count; i++)
+		blend(f->particle[i].x, f->particle[i].y, f->particle[i].color, f->particle[i].glyph);
 
-/* Funcion para detectar colision con paredes de la zona de juego*/
+	/*Mostrar informacion en la pantalla de juego*/
+	status:
+		// SCORE //
+		puts(SCORE_X - 4, SCORE_Y, GRAY, BLACK, STR(STR_SCORE));
+		puts(SCORE_X+5, SCORE_Y, BRIGHT|BLUE, BLACK, itoa(f->score, 10, 5));
 
-bool collide(s8 x, s8 y){
-	if (x<0 || x>(WELL_WIDTH-3) || y<2 || y>WELL_HEIGHT)
-		return true;
-	else
-		return false;
+		// VIDAS //
+		puts(LIVES_X, SCORE_Y, GRAY, BLACK, STR(STR_LIVES));
+		puts(LIVES_X+9, SCORE_Y, BRIGHT|RED, BLACK, itoa(f->lives, 10, 1));
 }
 
-
-bool collide_E(s8 y){
-	if ( y<2 || y>WELL_HEIGHT)
-		return true;
-	else
-		return false;
+void draw_GameOver(void){
+	puts(COLS/2 - 8 , WELL_HEIGHT/2, BRIGHT|GREEN, BLACK, STR(STR_GAMEOVER));
 }
 
-bool collide_l2(s8 x){
+void draw_level(u32 n){
+	puts(COLS/2 - 6 , WELL_HEIGHT/2, BRIGHT|GREEN, BLACK, STR(STR_LEVEL));
+	puts(COLS/2 + 5 , WELL_HEIGHT/2, BRIGHT|GREEN, BLACK, itoa(n, 10, 1));
+}
 
-	if (x <= (wall_I[17].x ) || (x+3) >= wall_D[17].x ){
-		lives -= 1;
-		player.estado = false;
-		return true;
-	}
-	else
-		return false;
+void draw_win(void){
+	puts(COLS/2 - 7 , WELL_HEIGHT/2, BRIGHT|GREEN, BLACK, STR(STR_WIN));
 }
 
-bool collide_met(s8 y){
-	if(y<1 || y>WELL_HEIGHT){
-		return true;
+/* Tabla de records en la portada, a la derecha: puesto, puntaje y nivel */
+
+#define BEST_X (49)
+#define BEST_Y (9)
+
+void draw_hiscores(const struct hiscore_table *t){
+	if(!t->count)
+		return;
+	puts(BEST_X, BEST_Y, BRIGHT|BLUE, BLACK, STR(STR_BEST));
+	for(u32 i=0; i<t->count; i++){
+		puts(BEST_X, BEST_Y + 1 + i, GRAY, BLACK, itoa(i + 1, 10, 1));
+		putc(BEST_X + 1, BEST_Y + 1 + i, GRAY, BLACK, '.');
+		puts(BEST_X + 3, BEST_Y + 1 + i, BRIGHT|GREEN, BLACK, itoa(t->entry[i].score, 10, 5));
+		putc(BEST_X + 9, BEST_Y + 1 + i, GRAY, BLACK, 'N');
+		puts(BEST_X + 10, BEST_Y + 1 + i, GRAY, BLACK, itoa(t->entry[i].level, 10, 1));
 	}
-	else
-		return false;
 }
 
 
-///////////// Funciones para la deteccion de colision /////////////////////
+/////////// Latencia /////////////////
 
-/* colision bala con enemigo*/
+/* Latencia de entrada a pantalla: cada tecla que llega al juego lleva el TSC
+   con que la leyo la tarea de entrada y el del paso de la simulacion que la
+   consumio; el renderizador le agrega el del present() del primer cuadro que
+   ya la incluye (lo que tarde el monitor en mostrarlo no se ve desde aqui).
+   Los tres tramos van a histogramas en us con baldes de potencias de 2 ms */
 
-void colision_B_E(void){
-/* Primero hacemos un for que recorra cada una de las balas, donde verifique si esa bala ha impactado
-	a alguno de los enemigos, enemigos que se recorren con otro for*/
+#define LAT_BUCKETS (10)	// <1 ms, 1-2, 2-4, ... 256 ms o mas
 
-	for(int yy=0; yy<5; yy++){
-		if(bullet[yy].estado){
-			for(int xx=0; xx<4; xx++){
-				if((bullet[yy].y<=(enemy[xx].y+2))){
-					if((bullet[yy].x>=enemy[xx].x)&&(bullet[yy].x<=(enemy[xx].x+2))){
-						enemy[xx].estado=false;
-						bullet[yy].estado=false;
-						score += 1;
-					}
-				}
+struct latency{
+	u32 count, max;
+	u32 bucket[LAT_BUCKETS];
+};
 
-			}
-		}
-	}
+/* Los llena el renderizador; la telemetria los lee sin sincronizar */
+struct latency lat_queue;	// teclado -> simulacion
+struct latency lat_frame;	// simulacion -> present()
+struct latency lat_total;	// teclado -> present()
+
+/* Del lado de la simulacion: el primer evento que cambio el juego desde el
+   ultimo cuadro publicado */
+u32 input_seq;
+u64 input_t, consume_t;
+bool input_pending;
+
+void lat_add(struct latency *l, u32 us){
+	u32 b = 0;
+	for (u32 ms = us / 1000; ms && b < LAT_BUCKETS - 1; ms >>= 1)
+		b++;
+	l->bucket[b]++;
+	l->count++;
+	if (us > l->max)
+		l->max = us;
 }
 
-/* Colision enemigo con jugador*/
-
-void colision_E_P(void){
-	for(int e=0; e<4; e++){
-		if(enemy[e].estado){
-			if(((enemy[e].x>=player.x)&&(enemy[e].x<(player.x + 3))) || ((enemy[e].x+3)<=(player.x+3))&&((enemy[e].x+3)> player.x)){
-				if((enemy[e].y+2)>=player.y){
-					enemy[e].estado=false;
-					player.estado=false;
-					lives -=1;
-				}
-			}
-		}
+/* Cota superior en ms del balde donde se llega al pct por ciento */
+u32 lat_percentile(const struct latency *l, u32 pct){
+	u32 want = (l->count * pct + 99) / 100, sum = 0;
+	for (u32 b = 0; b < LAT_BUCKETS; b++){
+		sum += l->bucket[b];
+		if (sum >= want)
+			return 1u << b;
 	}
+	return 1u << LAT_BUCKETS;
 }
 
-void colision_M_P(void){
-
-	for(int x=0; x<3; x++){
-		if(met[x].estado){
-			if(((met[x].x>=player.x)&&(met[x].x<(player.x+3)))||((met[x].x+2)<=(player.x+3))&&((met[x].x+3)>player.x)){
-				if((met[x].y+2)>=player.y){
-					met[x].estado=false;
-					player.estado=false;
-					lives -=1;
-				}
-			}
-		}
-	}
+/* Fila de abajo a la izquierda: percentiles de la latencia total y su
+   histograma, un caracter por balde segun cuantos eventos cayeron ahi */
+
+void draw_latency(void){
+	static const char shade[] = " .:-=+*#";
+	const struct latency *l = &lat_total;
+	char hist[LAT_BUCKETS + 1];
+	u32 top = 0;
+
+	if (!l->count)
+		return;
+	for (u32 b = 0; b < LAT_BUCKETS; b++)
+		if (l->bucket[b] > top)
+			top = l->bucket[b];
+	for (u32 b = 0; b < LAT_BUCKETS; b++)
+		hist[b] = shade[(l->bucket[b] * (sizeof(shade) - 2) + top - 1) / top];
+	hist[LAT_BUCKETS] = 0;
+
+	puts(0, ROWS - 1, GRAY, BLACK, "LAT p50<");
+	puts(8, ROWS - 1, BRIGHT|GREEN, BLACK, itoa(lat_percentile(l, 50), 10, 3));
+	puts(11, ROWS - 1, GRAY, BLACK, "ms p99<");
+	puts(18, ROWS - 1, BRIGHT|GREEN, BLACK, itoa(lat_percentile(l, 99), 10, 3));
+	puts(21, ROWS - 1, GRAY, BLACK, "ms [");
+	puts(25, ROWS - 1, BRIGHT|CYAN, BLACK, hist);
+	putc(25 + LAT_BUCKETS, ROWS - 1, GRAY, BLACK, ']');
 }
 
-/* Funcion para inicializar los diferentes aspectos de los personajes (player, enemigo y bala)*/
-
-void init(void){
-	player.i=0;
-	player.y=WELL_HEIGHT;  // 20
-	player.x=(WELL_WIDTH/2); // 11
-	player.estado= false;
-
-	/* Inicializar los valores de las balas*/
-	/* se realiza con un for debido a que es un array */
-	for(int xx=0; xx<5; xx++){
-		bullet[xx].y= player.y - 1;
-		bullet[xx].x= player.x + 1;
-		bullet[xx].estado = false;
-	}
-	/* Inicializar los valores de los enemigos*/
-	for(int ee=0; ee<4; ee++){
-		enemy[ee].i= ee+1;
-		enemy[ee].y= 2;
-		enemy[ee].x= 3 + ee*4;
-		enemy[ee].estado=false;
-	}
+/////////// Watchdog /////////////////
+
+/* Presupuesto de cada cuadro: si la pasada de la simulacion que publica
+   cuadros (de despertar a terminar) o el pintado de un cuadro pasan de
+   FRAME_BUDGET se cuenta, y en un registro circular queda el TSC con que
+   empezo y termino, cuanto tardo y la parte que mas tiempo se llevo (los
+   subsistemas del perfilador, publicar, pintar o presentar). Cada tarea tiene
+   su registro, asi cada uno tiene un solo escritor; los demas lo leen sin
+   sincronizar. F2 lo manda por el puerto serie y lo muestra en pantalla */
+
+#define WATCH_LOG (16)
+
+/* Partes de un cuadro: las del perfilador (enum prof_id) y estas */
+enum watch_part{
+	WATCH_PUBLISH = PROF_COUNT,
+	WATCH_OTHER,	// lo que no cae en ninguna parte medida
+	WATCH_DRAW,
+	WATCH_PRESENT,
+	WATCH_PARTS
+};
 
-	/// Valore necesarios a inicializar a default ///
-	posicion_x= REFER_MAX;
-	posicion_xD= REFER_MAXD;
-	level=1;
-	score=0;
-}
+static const char *const part_names[WATCH_PARTS] = {
+	"bullets", "enemies", "walls", "spawn", "collide", "particle", "snapshot", "timers",
+	"publish", "other", "draw", "present"
+};
 
-/* Se crea una funcion que permita ver el estado de la nave o Bala para saber si
-	si tiene que spawnear otra segun el estado*/
-void spawnear (void){
+struct overrun{
+	u64 start, end;	// TSC
+	u32 us;
+	u32 worst_us;
+	u8 worst;	// enum watch_part
+};
 
-	if(player.estado==false){
-		player.y=WELL_HEIGHT;  // 
-		player.x=(WELL_WIDTH/2 - 1); // 10
-		player.estado= true;
-	}
+struct watch{
+	const char *name;
+	u32 frames, overruns;
+	struct overrun log[WATCH_LOG];	// las ultimas; la siguiente va en overruns % WATCH_LOG
+};
 
-	for(int ee = 0; ee<4; ee++){
-		if(enemy[ee].estado==false){
-			enemy[ee].y = 2;
-			enemy[ee].x = 3 + ee*4;;
-			enemy[0].estado= true;
-		}
-	}
+struct watch sim_watch = {.name = "sim"}, render_watch = {.name = "render"};
+bool watch_show;	// F2: mostrar el registro en pantalla
 
-	
+/* Cuenta el cuadro y retorna true si paso del presupuesto */
+bool watch_over(struct watch *w, u64 start, u64 end){
+	w->frames++;
+	return ticks_us(end - start) > FRAME_BUDGET;
 }
 
-void spawnear2(void){
-	if(player.estado==false){
-		player.y=WELL_HEIGHT;  
-		player.x=(COLS/2 -1); 
-		player.estado= true;
-	}
+/* Guarda un cuadro largo; parts tiene los ticks de cada parte */
+void watch_record(struct watch *w, u64 start, u64 end, const u64 *parts){
+	u32 worst = 0;
+	for (u32 i = 1; i < WATCH_PARTS; i++)
+		if (parts[i] > parts[worst])
+			worst = i;
+	w->log[w->overruns++ % WATCH_LOG] = (struct overrun) {
+		start, end, ticks_us(end - start), ticks_us(parts[worst]), worst
+	};
+}
 
-	for(int m=0; m<3; m++){
-		if(met[m].estado==false){
-			met[m].x=(COLS/2 - 7) + m*6;
-			met[m].y= 3;
-			met[0].estado=true;
+/* En la esquina superior derecha: los ultimos cuadros largos de cada tarea,
+   con hace cuantos ms fueron, cuanto tardaron y la peor parte */
+
+#define WATCH_X (COLS - 36)
+#define WATCH_Y (2)
+#define WATCH_ROWS (6)
+
+void draw_watch(void){
+	const struct watch *ws[] = {&sim_watch, &render_watch};
+	u64 now = rdtsc();
+	u8 y = WATCH_Y;
+
+	for (u32 k = 0; k < 2; k++){
+		const struct watch *w = ws[k];
+		u32 n = w->overruns < WATCH_ROWS ? w->overruns : WATCH_ROWS;
+		puts(WATCH_X, y, BRIGHT|BLUE, BLACK, w->name);
+		puts(WATCH_X + 7, y, BRIGHT|RED, BLACK, itoa(w->overruns, 10, 5));
+		puts(WATCH_X + 12, y, GRAY, BLACK, " de ");
+		puts(WATCH_X + 16, y, GRAY, BLACK, itoa(w->frames, 10, 8));
+		y++;
+		for (u32 i = 0; i < n; i++, y++){
+			const struct overrun *o = &w->log[(w->overruns - 1 - i) % WATCH_LOG];
+			puts(WATCH_X, y, GRAY, BLACK, itoa(ticks_us(now - o->end) / 1000, 10, 6));
+			puts(WATCH_X + 6, y, GRAY, BLACK, "ms");
+			puts(WATCH_X + 9, y, BRIGHT|RED, BLACK, itoa(o->us, 10, 7));
+			puts(WATCH_X + 16, y, GRAY, BLACK, "us");
+			puts(WATCH_X + 19, y, BRIGHT|CYAN, BLACK, part_names[o->worst]);
+			puts(WATCH_X + 28, y, GRAY, BLACK, itoa(o->worst_us, 10, 6));
 		}
-
 	}
-
 }
 
-#define WELL_X  (COLS / 2 - WELL_WIDTH) // (80/2 - 22)= 18
-#define WELL_X2 (COLS / 2 - WELL_WIDTH2) // (80/2 - 14)= 26
+/////////// Renderizado /////////////////
 
-/*#define STATUS_X (COLS * 3/4)
-#define STATUS_Y (ROWS /2 -4)*/
+/* Muestra la utilizacion de cada nucleo en la fila superior */
 
-#define SCORE_X (COLS/2 - 4)
-#define SCORE_Y (ROWS-2)
+void draw_load(const struct frame *f){
+	for(u8 c=0; c<f->ncpu; c++){
+		puts(COLS - 20 + c*10, 0, GRAY, BLACK, "CPU");
+		puts(COLS - 17 + c*10, 0, GRAY, BLACK, itoa(c, 10, 1));
+		puts(COLS - 15 + c*10, 0, BRIGHT|GREEN, BLACK, itoa(f->load[c], 10, 3));
+		putc(COLS - 12 + c*10, 0, GRAY, BLACK, '%');
+	}
+}
 
-#define LIVES_X (3)
-#define LIVES_Y (SCORE_Y-2)
+/* Pinta un cuadro completo en el buffer de atras y lo presenta. En present_t
+   deja cuando empezo a copiarlo a la pantalla */
 
-/*Ahora creamos una funcion que permita dibujar los componentes del juego*/
+u64 present_t;
 
-s8 move_wall=0;
+void render(const struct frame *f, bool effects){
+	switch (f->screen){
+		case SCREEN_ABOUT:
+			clear(BLACK);
+			draw_about();
+			draw_hiscores(&f->hiscores);
+			break;
 
-void draw(void){
-	clear(BLACK);
-	u8 x, y;
+		case SCREEN_PLAY:
+			draw(f, effects);
+			break;
 
-	/* Pintar los bordes del area dejuego */
+		case SCREEN_BANNER:
+			clear(BLACK);
+			draw_level(f->level + 1);
+			break;
 
-	for (y=2; y<WELL_HEIGHT; y++){
-		putc(WELL_X-1, y, BLACK, GRAY, ' '); //Pared izquierda
-		putc(COLS / 2 + WELL_WIDTH, y, BLACK, GRAY, ' '); //Pared Derecha
-	}
+		case SCREEN_GAMEOVER:
+			clear(BLACK);
+			draw_GameOver();
+			break;
 
-	// Para crear efecto de movimiento en las paredes//
-	for (y=move_wall; y<WELL_HEIGHT; y+=2){
-		putc(WELL_X-1, y, GRAY, BLACK, ' '); //Pared izquierda
-		putc(COLS / 2 + WELL_WIDTH, y, GRAY, BLACK, ' '); //Pared Derecha
+		case SCREEN_WIN:
+			clear(BLACK);
+			draw_win();
+			break;
 	}
-
-	if(move_wall < 5)
-		move_wall +=1;
-	else
-		move_wall=0;
-
-
-	/*Se corrobora el estado de la nave*/
-	if(player.estado == true){
-		for(y=0; y<2; y++){
-			for(x=0; x<3; x++){
-				if (ships[player.i][y][x])
-					puts(WELL_X+player.x * 2 + 2*x, player.y + y, YELLOW, ships[player.i][y][x], "#");
-			}
-		}
+	if (effects){
+		draw_load(f);
+		draw_latency();
 	}
+	if (watch_show)
+		draw_watch();
+	present_t = rdtsc();
+	present();
+}
 
-	/* Codigo para el pintado de la bala, misma logica del movimiento del jugador*/
-
-	for(int bb = 0; bb < 5; bb++){
-		if(bullet[bb].estado == true)
-			//puts(bullet[bb].x, bullet[bb].y, GRAY, BLACK, "||");
-			puts(WELL_X + bullet[bb].x*2, bullet[bb].y, GRAY, BLACK, "|");
+/* Tareas que corren en el planificador */
+struct task *sim, *renderer;
+
+/* Toma una copia del estado del juego y la publica para el renderizador */
+
+void publish(enum screen screen){
+	struct frame *f = &frames[frame_tb.back];
+
+	f->screen = screen;
+	f->lvl = lvl;
+	f->level = level;
+	f->player = player;
+	f->bullet_count = bullet_limit;
+	memcpy(f->bullet, bullet, bullet_limit * sizeof(bullet[0]));
+	f->enemy_count = enemy_count;
+	memcpy(f->enemy, enemy, enemy_count * sizeof(enemy[0]));
+	memcpy(f->wall_I, wall_I, sizeof(wall_I));
+	memcpy(f->wall_D, wall_D, sizeof(wall_D));
+
+	/* Las particulas ya se pasan a celdas de pantalla, dejando fuera las que
+	   salieron del area de juego */
+	u32 n = 0;
+	for(u32 i=0; i<particles.count; i++){
+		s32 x = col(lvl, fix_int(particles.x[i])), y = fix_int(particles.y[i]);
+		if(x < 0 || x >= COLS || y < 2 || y >= SCORE_Y)
+			continue;
+		const struct ramp_color *c = particle_color(i);
+		f->particle[n].x = x;
+		f->particle[n].y = y;
+		f->particle[n].glyph = c->glyph;
+		f->particle[n].color = c->color;
+		n++;
 	}
+	f->particle_count = n;
+	f->move_wall = move_wall;
+	f->player_safe = player_safe;
+	f->score = score;
+	f->lives = lives;
+	f->ncpu = smp_cpus;
+	for(u32 c=0; c<smp_cpus; c++)
+		f->load[c] = cpu_load[c].percent;
+	f->hiscores = hiscores;
+	f->input_seq = input_seq;
+	f->input_t = input_t;
+	f->consume_t = consume_t;
+	input_pending = false;
+
+	tribuf_publish(&frame_tb);
+	task_wake(renderer);
+}
 
-	for(int ee=0; ee<4; ee++){
-		if(enemy[ee].estado == true){
-			for(y=0; y < 2; y++){
-				for(x=0; x < 3; x++){
-					if(ships[enemy[ee].i][y][x])
-						if(y==0)
-							puts(WELL_X+enemy[ee].x*2 + 2*x, enemy[ee].y + y, ships[enemy[ee].i][y][x], BLACK, "_" );
-						else
-							puts(WELL_X+enemy[ee].x*2 + 2*x, enemy[ee].y + y, ships[enemy[ee].i][y][x], BLACK, "V" );
-				}
-			}
-		}
-	}
+/* Tiempos en us de los cuadros de la simulacion y del renderizador. Cada tarea
+   suma los suyos y la simulacion los reporta y reinicia en cada paso de la
+   prueba de carga (sin sincronizar: es solo para el reporte) */
+struct frame_stats{
+	u32 count, sum, max;
+};
 
-	/*Mostrar informacion en la pantalla de juego*/
-	status:
-		// SCORE //
-		puts(SCORE_X - 4, SCORE_Y, GRAY, BLACK, "SCORE:");
-		puts(SCORE_X+5, SCORE_Y, BRIGHT|BLUE, BLACK, itoa(score, 10, 5));
+struct frame_stats sim_stats, render_stats;
+u32 frames_skipped;
 
-		// VIDAS //
-		puts(LIVES_X, SCORE_Y, GRAY, BLACK, "LIVES:");
-		puts(LIVES_X+9, SCORE_Y, BRIGHT|RED, BLACK, itoa(lives, 10, 1));
+void stats_add(struct frame_stats *s, u32 us){
+	s->count++;
+	s->sum += us;
+	if (us > s->max)
+		s->max = us;
 }
- 
-////////////////// Funcion para dibujar zona de juego del nivel 2 /////////////////////
 
+/* Para la comparacion de sonido (ver Sonido) cada pasada junta ademas los
+   tiempos de cuadro de ambas tareas en histogramas de AB_BUCKET us, de
+   donde sale el p99 */
+#define AB_BUCKET (100)	// us
+#define AB_BUCKETS (64)	// el ultimo junta todo lo de 6.3 ms o mas
 
-/* Para inicializar valores en la estructura de paredes*/
-
-void init_2(void){ 
-	u8 x, y;
-	u8 cont=0;
-	for(x=0; x<18; x++){
-		if(posicion_x >= REFER_MIN && cont < 10){
-			posicion_x = posicion_x - 1;
-			posicion_xD= posicion_xD - 1;
-			wall_I[x].direccion=true;
-			wall_D[x].direccion=true;
-			cont +=1;
-		}
-		if(posicion_x <= REFER_MAX && cont >= 10){
-			posicion_x = posicion_x + 1;
-			posicion_xD= posicion_xD + 1;
-			wall_I[x].direccion=false;
-			wall_D[x].direccion=false;
-			cont +=1;
-		}
-		wall_I[x].x=posicion_x;
-		wall_I[x].y= 3 + x;
-		wall_D[x].x= posicion_xD;
-		wall_D[x].y= 3 + x;
+struct frame_hist{
+	u32 count, max;
+	u64 sum;
+	u32 bucket[AB_BUCKETS];
+};
 
-		if (cont == 19)
-			cont = 0;
-	}
- /// Iniciar valores del jugador /// 
-	player.i=0;
-	player.y=WELL_HEIGHT;  
-	player.x=(COLS/2 - 1); 
-	player.estado= false;
-
- /// Iniciar valores del meteorito /// 
-	for(int m=0; m<3; m++){
-			met[m].x=(COLS/2 - 7)+ m*6;
-			met[m].y= 3;
-			met[m].estado=false;
-			met[m].i=0;
-	}
-	
-}
+struct ab_pass{
+	struct frame_hist sim, render;
+	u32 overruns;	// cuadros largos de ambas tareas (watchdog)
+};
 
+struct ab_pass ab[2];
+s32 ab_run = -1;	// 0 sin sonido, 1 con sonido, -1 si no se esta comparando
 
-void draw_2(){
-	clear(BLACK);
-	u8 x, y;
+void hist_add(struct frame_hist *h, u32 us){
+	u32 b = us / AB_BUCKET;
+	h->bucket[b < AB_BUCKETS ? b : AB_BUCKETS - 1]++;
+	h->count++;
+	h->sum += us;
+	if (us > h->max)
+		h->max = us;
+}
 
-////// Para movimiento de paredes del mapa ///////
-	for(x=0; x<18; x++){
-		putc(wall_I[x].x, wall_I[x].y, BLACK, GRAY, ' ');
-		putc(wall_D[x].x, wall_D[x].y, BLACK, GRAY, ' ');
+/* Cota superior en us del balde donde se llega al pct por ciento */
+u32 hist_percentile(const struct frame_hist *h, u32 pct){
+	u32 want = (h->count * pct + 99) / 100, sum = 0;
+	for (u32 b = 0; b < AB_BUCKETS - 1; b++){
+		sum += h->bucket[b];
+		if (sum >= want)
+			return (b + 1) * AB_BUCKET;
 	}
+	return h->max;
+}
 
-	for(x=0; x<18; x++){
-
-		if(wall_I[x].x >= REFER_MIN && wall_I[x].direccion==true){
-			wall_I[x].x -=1;
+/* Renderizado degradado: 0 normal, 1 sin efectos y desde 2 ademas se pinta
+   solo uno de cada degrade cuadros. Sube si lo que cuesta cada cuadro
+   publicado pasa de FRAME_BUDGET y baja cuando sobra la mitad; asi un
+   renderizado lento nunca frena a la simulacion */
+#define MAX_DEGRADE (8)
+
+u32 degrade;
+
+/* Tarea de renderizado (en el segundo nucleo si lo hay): cada vez que la
+   simulacion publica un cuadro nuevo lo toma del triple buffer y lo pinta.
+   Si no hay cuadro nuevo duerme; publish() la despierta */
+
+void render_main(void *arg){
+	u32 n = 0, seen = 0;
+	u64 next = 0, period = settings.fps ? div_u64(tpms * 1000, settings.fps) : 0;
+	while (true){
+		/* Con fps no se pinta antes de tiempo; al despertar se toma el cuadro
+		   mas nuevo y los de en medio se pierden */
+		if (period && rdtsc() < next){
+			task_sleep_until(next);
+			continue;
 		}
-
-		if(wall_I[x].x <= REFER_MAX && wall_I[x].direccion==false){
-			wall_I[x].x +=1;
+		if (!tribuf_acquire(&frame_tb)){
+			task_sleep_ms(1);
+			continue;
+		}
+		if (degrade >= 2 && ++n % degrade){
+			frames_skipped++;
+			continue;
 		}
 
-		if(wall_I[x].x == REFER_MIN)
-			wall_I[x].direccion = false;
-		if(wall_I[x].x == REFER_MAX)
-			wall_I[x].direccion = true;
-		
-	}
-
-	for(x=0; x<18; x++){
-		
-		if(wall_D[x].x >= REFER_MIND && wall_D[x].direccion==true){
-			wall_D[x].x -=1;
+		/* Pintar y copiar tarda mucho menos que el retrazado, asi que se
+		   empieza cuando arranca y la espera no cuenta como costo del cuadro */
+		if (settings.vsync)
+			wait_retrace();
+
+		const struct frame *f = &frames[frame_tb.front];
+		u64 t = rdtsc();
+		next = t + period;
+		render(f, !degrade);
+		u64 done = rdtsc();
+		u32 us = ticks_us(done - t);
+		stats_add(&render_stats, us);
+		if (ab_run >= 0)
+			hist_add(&ab[ab_run].render, us);
+		if (watch_over(&render_watch, t, done)){
+			u64 parts[WATCH_PARTS] = {0};
+			parts[WATCH_DRAW] = present_t - t;
+			parts[WATCH_PRESENT] = done - present_t;
+			watch_record(&render_watch, t, done, parts);
 		}
 
-		if(wall_D[x].x <= REFER_MAXD && wall_D[x].direccion==false){
-			wall_D[x].x +=1;
+		/* Primer cuadro presentado con un evento nuevo */
+		if (f->input_seq != seen){
+			seen = f->input_seq;
+			lat_add(&lat_queue, ticks_us(f->consume_t - f->input_t));
+			lat_add(&lat_frame, ticks_us(done - f->consume_t));
+			lat_add(&lat_total, ticks_us(done - f->input_t));
 		}
 
-		if(wall_D[x].x == REFER_MIND)
-			wall_D[x].direccion = false;
-		if(wall_D[x].x == REFER_MAXD)
-			wall_D[x].direccion = true;
+		u32 cost = degrade >= 2 ? us / degrade : us;
+		if (cost > FRAME_BUDGET && degrade < MAX_DEGRADE)
+			degrade++;
+		else if (cost < FRAME_BUDGET / 2 && degrade)
+			degrade--;
 	}
+}
 
-	//////////// Para dibujar nave player //////////////
-
-	/*Se corrobora el estado de la nave*/
-	if(player.estado == true){
-		for(y=0; y<2; y++){
-			for(x=0; x<3; x++){
-				if (ships[player.i][y][x])
-					puts(player.x+x, player.y + y, YELLOW, ships[player.i][y][x], "#");
-			}
-		}
-	}
+/////////// Entrada /////////////////
 
-	//////////// Para dibujar meteorito //////////////
+/* Cola de teclas de la tarea de entrada a la de simulacion. Ambas corren en el
+   mismo nucleo, asi que no hace falta nada atomico */
+#define KEY_QUEUE (16)
 
-	for(int m=0; m<3; m++){
-		if(met[m].estado == true){
-			for(y=0; y<1; y++){
-				for(x=0; x<2; x++){
-					if (meteo[met[m].i][y][x])
-						puts(met[m].x + x, met[m].y + y, BRIGHT|meteo[met[m].i][y][x], BLACK, "X" );
-				}
-			}
-		}
-	}
+/* Cada tecla lleva si se apreto o se solto y el TSC con que se leyo, para
+   medir la latencia */
+struct key_event{
+	u8 key;
+	bool down;
+	u64 t;
+};
 
-	status2:
+struct key_event key_queue[KEY_QUEUE];
+u32 key_head, key_tail;
 
-		// SCORE //
-		puts(SCORE_X - 4, SCORE_Y, GRAY, BLACK, "SCORE:");
-		puts(SCORE_X+5, SCORE_Y, BRIGHT|BLUE, BLACK, itoa(score, 10, 5));
+void key_push(u8 key, bool down, u64 t){
+	if (key_head - key_tail < KEY_QUEUE)
+		key_queue[key_head++ % KEY_QUEUE] = (struct key_event) {key, down, t};
+}
 
-		// VIDAS //
-		puts(LIVES_X, SCORE_Y, GRAY, BLACK, "LIVES:");
-		puts(LIVES_X+9, SCORE_Y, BRIGHT|RED, BLACK, itoa(lives, 10, 1));
+/* Retorna 0 si no hay teclas pendientes; si no deja en *down si se apreto y
+   en *t cuando se leyo (si no son 0) */
+u8 key_pop(bool *down, u64 *t){
+	if (key_tail == key_head)
+		return 0;
+	struct key_event *e = &key_queue[key_tail++ % KEY_QUEUE];
+	if (down)
+		*down = e->down;
+	if (t)
+		*t = e->t;
+	return e->key;
+}
 
+/* Tarea de entrada: cada milisegundo saca lo que haya mandado el teclado y
+   despierta a la simulacion solo si una tecla cambio. Sin eventos solo lee
+   el estado del controlador. tpms ya no se recalibra: el tiempo del juego
+   se calcula con el y con cada nueva estimacion (que varia cerca de un ms
+   por segundo) saltaria hacia adelante o hacia atras */
+
+void input_main(void *arg){
+	u8 key;
+	bool down, any;
+	while (true){
+		for (any = false; scan(&key, &down); any = true)
+			key_push(key, down, rdtsc());
+		if (any)
+			task_wake(sim);
+		task_sleep_ms(1);
+	}
 }
 
-////////// Funciones de movimiento //////////
+/////////// Telemetria /////////////////
 
-/* Intenta mover la nave una distancia dx y dy, devuelve true si tiene exito*/
+char *append(char *p, const char *s){
+	while (*s)
+		*p++ = *s++;
+	*p = 0;
+	return p;
+}
 
-bool move_player(s8 dx, s8 dy){
-	if(!(player.estado))
-		return false;
-	if(collide(player.x + dx, player.y+dy)){
-		return false;
+/* Una linea por histograma de latencia: eventos, percentiles, maximo y la
+   cuenta de cada balde */
+void report_latency(const char *name, const struct latency *l){
+	char line[192], *p = line;
+
+	if (!l->count)
+		return;
+	p = append(p, name);
+	p = append(p, ": n=");
+	p = utoa(p, l->count);
+	p = append(p, " p50<");
+	p = utoa(p, lat_percentile(l, 50));
+	p = append(p, "ms p99<");
+	p = utoa(p, lat_percentile(l, 99));
+	p = append(p, "ms max=");
+	p = utoa(p, l->max);
+	p = append(p, "us hist=");
+	for (u32 b = 0; b < LAT_BUCKETS; b++){
+		p = utoa(p, l->bucket[b]);
+		p = append(p, b < LAT_BUCKETS - 1 ? "," : "");
 	}
-	player.x += dx;
-	player.y += dy;
-	return true;
+	append(p, "\r\n");
+	serial_puts(line);
 }
 
-bool move_player2(s8 dx, s8 dy){
-	if(!(player.estado))
-		return false;
-	 // Movimiento de nave player en caso de que sea en nivel 2
-	if(collide_l2(player.x + dx))
-		return false;
-	player.x += dx;
-	return true;
-}
+/* Envia por el puerto serie la utilizacion de cada nucleo, los microsegundos
+   que corrio cada tarea y los de cada subsistema del juego desde el reporte
+   anterior */
+
+void report(void){
+	static u64 prev[MAX_TASKS], prev_prof[PROF_COUNT], prev_bytes;
+	static u32 prev_pushes, prev_irqs, prev_cycles;
+	char line[512], *p = line;
+
+	for (u32 c = 0; c < smp_cpus; c++){
+		p = append(p, "cpu");
+		p = utoa(p, c);
+		p = append(p, "=");
+		p = utoa(p, cpu_load[c].percent);
+		p = append(p, "% ");
+	}
+	for (u32 i = 0; i < MAX_TASKS; i++){
+		if (tasks[i].state == TASK_FREE)
+			continue;
+		u64 run = tasks[i].runtime;
+		p = append(p, tasks[i].name);
+		p = append(p, "=");
+		p = utoa(p, ticks_us(run - prev[i]));
+		p = append(p, "us ");
+		prev[i] = run;
+	}
+	if (prof_enabled){
+		p = append(p, "| ");
+		for (u32 i = 0; i < PROF_COUNT; i++){
+			p = append(p, part_names[i]);
+			p = append(p, "=");
+			p = utoa(p, ticks_us(prof_time[i] - prev_prof[i]));
+			p = append(p, "us ");
+		}
+	}
 
-bool move_bullet(s8 dx, s8 dy, s8 b){
-	if (!(bullet[b].estado))
-		return false;
-	if (collide(bullet[b].x + dx, bullet[b].y + dy))
-		return false;
-	bullet[b].x += dx;
-	bullet[b].y += dy;
-	return true;
+	/* Historia de rebobinado: bytes y tiempo por imagen desde el reporte
+	   anterior, contra el tamano de la imagen completa */
+	u32 snaps = history.pushes - prev_pushes;
+	if (prof_enabled && snaps){
+		p = append(p, "| snap=");
+		p = utoa(p, (u32) div_u64(history.bytes - prev_bytes, snaps));
+		p = append(p, "B/");
+		p = utoa(p, history.size);
+		p = append(p, "B ");
+		p = utoa(p, (u32) div_u64(ticks_us((prof_time[PROF_SNAPSHOT] - prev_prof[PROF_SNAPSHOT]) * 1000), snaps));
+		p = append(p, "ns hist=");
+		p = utoa(p, history.count);
+		p = append(p, " ");
+	}
+	prev_pushes = history.pushes;
+	prev_bytes = history.bytes;
+
+	/* Costo del timer (y del secuenciador de sonido) en el BSP: ticks
+	   atendidos, us dentro del manejador y ns por tick. El AP no lo ve */
+	u32 irqs = irq_count - prev_irqs, cycles = irq_cycles - prev_cycles;
+	if (irqs){
+		p = append(p, "| irq=");
+		p = utoa(p, irqs);
+		p = append(p, " ");
+		p = utoa(p, ticks_us(cycles));
+		p = append(p, "us ");
+		p = utoa(p, (u32) div_u64(ticks_us((u64) cycles * 1000), irqs));
+		p = append(p, "ns ");
+	}
+	prev_irqs += irqs;
+	prev_cycles += cycles;
+
+	p = append(p, "| largos sim=");
+	p = utoa(p, sim_watch.overruns);
+	p = append(p, " render=");
+	p = utoa(p, render_watch.overruns);
+	p = append(p, " ");
+	for (u32 i = 0; i < PROF_COUNT; i++)
+		prev_prof[i] = prof_time[i];
+	append(p, "\r\n");
+	serial_puts(line);
+	report_latency("lat teclado-sim", &lat_queue);
+	report_latency("lat sim-pantalla", &lat_frame);
+	report_latency("lat total", &lat_total);
 }
 
-/* Prueba de enemigo*/
-bool move_enemy(s8 dx, s8 dy, s8 e){
-	if(!(enemy[e].estado))
-		return false;
-	if(collide_E(enemy[e].y+dy)){
-		lives -=1;
-		return false;
+/* Los ajustes con que arranco, en el orden de la tabla */
+void report_settings(void){
+	char line[192], *p = line;
+	p = append(p, "config:");
+	for (u32 i = 0; i < setting_count; i++){
+		p = append(p, " ");
+		p = append(p, setting_table[i].name);
+		p = append(p, "=");
+		p = utoa(p, setting_get(&setting_table[i]));
 	}
-	enemy[e].x += dx;
-	enemy[e].y += dy;
-	return true;
+	append(p, "\r\n");
+	serial_puts(line);
 }
 
+/* Volcado del registro de cuadros largos de cada tarea, del mas viejo al mas
+   nuevo, con los TSC de inicio y fin en hexadecimal */
 
-bool move_meteo(s8 dx, s8 dy, s8 m){
-	if(!(met[m].estado))
-		return false;
-	if(collide_met(met[m].y+dy)){
-		score += 1;
-		return false;
-	}
-	met[m].y += dy;
-	met[m].x += dx;
-	
-	return true;
+char *append_hex(char *p, u64 v){
+	for (s32 s = 60; s >= 0; s -= 4)
+		*p++ = "0123456789ABCDEF"[(v >> s) & 0xF];
+	*p = 0;
+	return p;
 }
 
-/* Funcion que permite colocar el estado de la bala en True en caso de que se dispare
-	eso sucede cuando la funcion se llama*/
-void disparar(void){
-	for(int bb = 0; bb<5; bb++){
-		if(bullet[bb].estado==false){
-			bullet[bb].estado=true;
-			bullet[bb].x = player.x + 1;
-			bullet[bb].y = player.y -1;
-			return;
+void watch_dump(void){
+	const struct watch *ws[] = {&sim_watch, &render_watch};
+	u64 now = rdtsc();
+	char line[160], *p;
+
+	for (u32 k = 0; k < 2; k++){
+		const struct watch *w = ws[k];
+		u32 n = w->overruns < WATCH_LOG ? w->overruns : WATCH_LOG;
+		p = append(line, "watchdog ");
+		p = append(p, w->name);
+		p = append(p, ": ");
+		p = utoa(p, w->overruns);
+		p = append(p, " de ");
+		p = utoa(p, w->frames);
+		p = append(p, " cuadros pasaron de ");
+		p = utoa(p, FRAME_BUDGET);
+		append(p, "us\r\n");
+		serial_puts(line);
+		for (u32 i = n; i-- > 0; ){
+			const struct overrun *o = &w->log[(w->overruns - 1 - i) % WATCH_LOG];
+			p = append(line, "  tsc=");
+			p = append_hex(p, o->start);
+			p = append(p, "-");
+			p = append_hex(p, o->end);
+			p = append(p, " ");
+			p = utoa(p, o->us);
+			p = append(p, "us peor=");
+			p = append(p, part_names[o->worst]);
+			p = append(p, " ");
+			p = utoa(p, o->worst_us);
+			p = append(p, "us hace ");
+			p = utoa(p, ticks_us(now - o->end) / 1000);
+			append(p, "ms\r\n");
+			serial_puts(line);
 		}
 	}
 }
 
-/* Funcion para actualizar el estado de ciertos elementos como:
-	movimiento de bala y de los enemigos*/
-void update(void){
-	for(int bb=0; bb<5; bb++){
-		if(!(move_bullet(0,-1, bb)))
-			bullet[bb].estado=false;
-	}
+/* Tarea de telemetria: arma un reporte cada TELEMETRY_INTERVAL ms y vacia el
+   buffer del puerto serie de a poco, sin detener nunca un cuadro */
 
-	for(int ee=0; ee<4; ee++){
-		if(!(move_enemy(0, 1, ee)))
-			enemy[ee].estado=false;
-		if(enemy[3].y==4)
-			enemy[1].estado=true;
-		if(enemy[1].y==5)
-			enemy[2].estado=true;
-		if(enemy[0].y==5)
-			enemy[3].estado=true;
+void telemetry_main(void *arg){
+	u64 next = rdtsc();
+	while (true){
+		if (rdtsc() >= next){
+			report();
+			next = rdtsc() + ms_ticks(TELEMETRY_INTERVAL);
+		}
+		serial_flush();
+		task_sleep_ms(1);
 	}
-
 }
 
-void update2(void){
-	for(int m=0; m<3; m++){
-		if(!(move_meteo(0,1, m)))
-			met[m].estado=false;
-		if(met[0].y==10)
-			met[1].estado=true;
-		if(met[1].y==9)
-			met[2].estado=true;
-	}
-}
+/////////// Disco /////////////////
 
-/* Funcion para detectar cuando se ha perdido el juego GAME OVER */
+/* La tabla de records vive en el sector HISCORE_LBA del disco (el -hda de
+   QEMU). Al arrancar se lee ese sector una vez, queda en el cache y de ahi
+   sale la tabla; guardarla es copiarla al cache (bcache.h), y la tarea de
+   disco la baja despues. Sin disco los records duran hasta apagar */
 
-bool game_over(){
-	if(lives==0){
-		lives=4;
-		return true;
+bool disk_present;
+
+void load_hiscores(void){
+	const u8 *s;
+	if (!(disk_present = ata_init())){
+		serial_puts("disco: no hay\r\n");
+		return;
 	}
-	return false;
+	if ((s = bcache_read(HISCORE_LBA)) && hiscores_load(s))
+		serial_puts("disco: records cargados\r\n");
+	else
+		serial_puts("disco: sin records\r\n");
 }
 
-void draw_GameOver(void){
-	puts(COLS/2 - 8 , WELL_HEIGHT/2, BRIGHT|GREEN, BLACK, "G A M E   O V E R !!");
-}
+_Static_assert(sizeof(struct hiscore_table) <= ATA_SECTOR, "la tabla de records no cabe en un sector");
 
-/* Funcion para detectar cambio de nivel*/
-bool next_level(s8 l){
-	if(score==13 && l==1)
-		return true;
-	if(score==26 && l==2)
-		return true;
-	
-	return false;
+void save_hiscores(void){
+	static u8 sector[ATA_SECTOR];
+	memcpy(sector, &hiscores, sizeof(hiscores));
+	if (!bcache_write(HISCORE_LBA, sector))
+		hiscores_dirty = true;	// cache lleno; se intenta en la siguiente vuelta
 }
 
-void drawlevel_2(void){
-	puts(COLS/2 - 6 , WELL_HEIGHT/2, BRIGHT|GREEN, BLACK, "L E V E L  2");
+/* Baja lo que haya sucio en el cache cada DISK_INTERVAL ms. Mientras el disco
+   trabaja cede el procesador (ata_idle), asi no frena a la simulacion */
+void disk_main(void *arg){
+	ata_idle = task_yield;
+	while (true){
+		while (bcache_flush())
+			;
+		task_sleep_ms(DISK_INTERVAL);
+	}
 }
 
-void draw_win(void){
-	puts(COLS/2 - 7 , WELL_HEIGHT/2, BRIGHT|GREEN, BLACK, "Y O U  W I N !!!");
-}
+/////////// Sonido /////////////////
 
+/* Una lista de notas por sonido del juego (enum sound); la prioridad es el
+   orden del enum, asi un disparo no corta el game over */
 
-/////////// Funcion principal del juego /////////////////
+static const struct note tune_shot[] = {{1760, 20}, {1320, 20}, {0, 0}};
+static const struct note tune_hit[] = {{220, 30}, {0, 10}, {165, 40}, {0, 0}};
+static const struct note tune_crash[] = {{110, 60}, {0, 20}, {98, 60}, {0, 20}, {82, 120}, {0, 0}};
+static const struct note tune_level[] = {{523, 80}, {659, 80}, {784, 80}, {1047, 160}, {0, 0}};
+static const struct note tune_gameover[] = {
+	{392, 200}, {0, 40}, {370, 200}, {0, 40}, {349, 200}, {0, 40}, {330, 500}, {0, 0}
+};
+static const struct note tune_win[] = {
+	{523, 120}, {659, 120}, {784, 120}, {1047, 240}, {0, 60}, {784, 120}, {1047, 400}, {0, 0}
+};
 
-noreturn kernel_main(){ 
+static const struct note *const tunes[SOUND_COUNT] = {
+	tune_shot, tune_hit, tune_crash, tune_level, tune_gameover, tune_win
+};
 
-begin:
-	clear(BLACK);
-	draw_about();
-	init();
-
-	/*Deteccion de tecla para iniciar*/
-	u8 key, ult_tecla;
-	int out1=0;
-	while (out1 != 1){
-		if ((key = scan())){
-			if (key == KEY_ENTER)
-				out1 = 1;
-		}
+/* De lo que pidio el paso solo se toca lo de mayor prioridad */
+void play_sounds(u32 bits){
+	if (bits){
+		u32 s = 31 - __builtin_clz(bits);
+		sound_play(tunes[s], s);
 	}
+}
 
-	/* Espera un segundo completo para calibrar el tiempo*/
-	u32 itpms;
-	tps();
-	itpms=tpms;
-	while (tpms==itpms)
-		tps();
-	itpms=tpms;
-	while (tpms==itpms)
-		tps();
-
-	clear(BLACK);
-	spawnear();
-	draw();
+/* Comparacion (opcion soundab): la misma prueba de carga, con la misma
+   semilla, se juega primero sin el secuenciador en el timer y despues con
+   el tocando sin parar. Como el sonido vive en la interrupcion, los tiempos
+   de cuadro y los cuadros largos de ambas pasadas tendrian que coincidir; al
+   final se reportan lado a lado por el puerto serie */
 
-loop:	
-	tps();
-	bool updated = false;
+static u32 ab_overruns0;
 
-	if ((key=scan())){
-		ult_tecla=key;
+static u32 overruns_now(void){
+	return sim_watch.overruns + render_watch.overruns;
+}
 
-		switch (key){
-			case KEY_RIGHT:
-				move_player(2,0);
-				break;
+void sound_ab_pass(u32 n){
+	ab[n] = (struct ab_pass) {0};
+	ab_overruns0 = overruns_now();
+	irq_timer = n ? sound_tick : 0;
+	particle_seed(settings.seed);
+	ab_run = n;
+}
 
-			case KEY_LEFT:
-				move_player(-2,0);
-				break;
+/* "nombre media a/bus p99 a/bus max a/bus" de las dos pasadas */
+static void report_ab(const char *name, const struct frame_hist *h0, const struct frame_hist *h1){
+	char line[160], *p = line;
+	p = append(p, name);
+	p = append(p, " media ");
+	p = utoa(p, h0->count ? (u32) div_u64(h0->sum, h0->count) : 0);
+	p = append(p, "/");
+	p = utoa(p, h1->count ? (u32) div_u64(h1->sum, h1->count) : 0);
+	p = append(p, "us p99 ");
+	p = utoa(p, hist_percentile(h0, 99));
+	p = append(p, "/");
+	p = utoa(p, hist_percentile(h1, 99));
+	p = append(p, "us max ");
+	p = utoa(p, h0->max);
+	p = append(p, "/");
+	p = utoa(p, h1->max);
+	p = append(p, "us cuadros ");
+	p = utoa(p, h0->count);
+	p = append(p, "/");
+	p = utoa(p, h1->count);
+	append(p, "\r\n");
+	serial_puts(line);
+}
 
-			case KEY_SPACE:
-				disparar();
-				break;
-		}
-		updated = true;
+/* Cada vuelta de la simulacion: mantiene sonando la segunda pasada y, cuando
+   termina la prueba de carga, arranca la siguiente o reporta */
+void sound_ab(void){
+	if (ab_run < 0)
+		return;
+	if (stress_mode){
+		if (ab_run == 1 && !sound_busy())
+			sound_play(tune_win, 0);
+		return;
 	}
 
-	if(interval(TIMER_UPDATE, speed)){
-		update();
-		spawnear();
-		updated=true;
-
+	ab[ab_run].overruns = overruns_now() - ab_overruns0;
+	if (ab_run == 0){
+		sound_ab_pass(1);
+		stress_start();
+		return;
 	}
 
-	if(updated){
-		draw();
-		colision_B_E();
-		colision_E_P();
-
-		if(game_over()){ // Comprueba si hemos perdido todas las vidas
-			clear(BLACK);
-			draw_GameOver();
+	char line[96], *p = line;
+	ab_run = -1;
+	irq_timer = settings.sound ? sound_tick : 0;
+	serial_puts("sonido A/B (sound=0/sound=1):\r\n");
+	report_ab(" sim", &ab[0].sim, &ab[1].sim);
+	report_ab(" render", &ab[0].render, &ab[1].render);
+	p = append(p, " cuadros largos ");
+	p = utoa(p, ab[0].overruns);
+	p = append(p, "/");
+	p = utoa(p, ab[1].overruns);
+	append(p, "\r\n");
+	serial_puts(line);
+}
 
-			itpms=tpms;
-			while (tpms==itpms)
-				tps();
-			itpms=tpms;
-			while (tpms==itpms)
-				tps();
+/////////// Simulacion /////////////////
 
-			goto begin;
-		}
+/* El juego (game.c) corre en la tarea de simulacion: recibe las teclas de la
+	tarea de entrada y los ms desde que arranco la tarea */
 
-		if(next_level(1)){
-			clear(BLACK);
-			goto loop2;
+u64 sim_t0;		// TSC cuando arranco la simulacion
 
-		}
-	}
-
-	goto loop;
+u64 plat_time(void){
+	return rdtsc();
+}
 
-	loop2:
-		
-		drawlevel_2();
-		init_2();
+/* Milisegundos desde que arranco la simulacion; tpms queda fijo desde
+   clock_calibrate(), asi que nunca retrocede */
+u32 now_ms(void){
+	return (u32) div_u64(rdtsc() - sim_t0, (u32) tpms);
+}
 
-		tps();
-		itpms=tpms;
-		while (tpms==itpms)
-			tps();
-		itpms=tpms;
-		while (tpms==itpms)
-			tps();
+/* Traduce un codigo de escaneo a una entrada del juego */
+enum input key_input(u8 key){
+	switch (key){
+		case KEY_LEFT:	return INPUT_LEFT;
+		case KEY_RIGHT:	return INPUT_RIGHT;
+		case KEY_SPACE:	return INPUT_FIRE;
+		case KEY_ENTER:	return INPUT_START;
+		case KEY_BACKSPACE:	return INPUT_REWIND;
+		default:	return INPUT_NONE;
+	}
+}
 
-		clear(BLACK);
-		spawnear2();
-		draw_2();
+/* Al terminar cada paso de la prueba de carga manda por el puerto serie el
+	tiempo de cuadro de la simulacion y del renderizador durante ese paso */
+
+void stress_report(void){
+	static u32 seen, entities, bullets, peak;
+	u32 now = stress_mode ? stress_step : 0;
+	char line[192], *p = line;
+
+	if (particles.count > peak)
+		peak = particles.count;
+	if (now == seen)
+		return;
+	if (seen){
+		p = append(p, "stress ");
+		p = utoa(p, seen);
+		p = append(p, ": entidades=");
+		p = utoa(p, entities);
+		p = append(p, " balas=");
+		p = utoa(p, bullets);
+		p = append(p, " particulas=");
+		p = utoa(p, peak);
+		p = append(p, " sim=");
+		p = utoa(p, sim_stats.count ? sim_stats.sum / sim_stats.count : 0);
+		p = append(p, "/");
+		p = utoa(p, sim_stats.max);
+		p = append(p, "us render=");
+		p = utoa(p, render_stats.count ? render_stats.sum / render_stats.count : 0);
+		p = append(p, "/");
+		p = utoa(p, render_stats.max);
+		p = append(p, "us cuadros=");
+		p = utoa(p, render_stats.count);
+		p = append(p, " saltados=");
+		p = utoa(p, frames_skipped);
+		p = append(p, " degradado=");
+		p = utoa(p, degrade);
+		append(p, "\r\n");
+		serial_puts(line);
+	}
+	seen = now;
+	entities = enemy_count;
+	bullets = bullet_limit;
+	peak = 0;
+	sim_stats = (struct frame_stats) {0};
+	render_stats = (struct frame_stats) {0};
+	frames_skipped = 0;
+}
 
-	loop2_1:
+/* Tarea de simulacion */
 
-		tps();
-		bool updated2 = false;
+void sim_main(void *arg){
+	u8 key;
+	bool down;
+	u64 kt, prof0[PROF_COUNT], pub;
 
-		if ((key=scan())){
-			ult_tecla=key;
+	sim_t0 = rdtsc();
+	game_init(pack, sprites, sprite_count);
+	if (settings.stress){
+		stress_steps = settings.stress;
+		if (settings.soundab)
+			sound_ab_pass(0);
+		stress_start();
+	}
 
-			switch (key){
-				case KEY_RIGHT:
-					move_player2(2,0);
-					break;
+	while (true){
+		u64 t = rdtsc();
+		bool frame = false;
 
-				case KEY_LEFT:
-					move_player2(-2,0);
-					break;
+		for (u32 i = 0; i < PROF_COUNT; i++)
+			prof0[i] = prof_time[i];
+		pub = 0;
 
-				// case KEY_SPACE:
-				// 	disparar();
-				// 	break;
+		while ((key=key_pop(&down, &kt))){
+			if (key == KEY_F2){
+				if (down){
+					watch_show = !watch_show;
+					watch_dump();
+					dirty = true;	// para que se pinte ya
+				}
+				continue;
+			}
+			/* Se mide la primera tecla que cambia algo (pide un cuadro); las
+			   que no cambian nada no tienen cuadro que esperar */
+			enum input in = key_input(key);
+			bool idle = !dirty;
+			game_key(in, down);
+			if (in != INPUT_NONE && down && idle && dirty && !input_pending){
+				input_pending = true;
+				input_seq++;
+				input_t = kt;
 			}
-			//updated2 = true;
 		}
 
-		if(interval(TIMER_UPDATE, speed)){
-			update2();
-			spawnear2();
-			updated2=true;
+		game_advance(now_ms());
+		if (input_pending)
+			consume_t = rdtsc();
+		play_sounds(sounds);
+		sounds = 0;
+		sound_ab();
+
+		while (dirty){
+			u64 p = rdtsc();
+			dirty = false;
+			frame = true;
+			publish(screen);
+			pub += rdtsc() - p;
+			game_check();
 		}
-
-		if (updated2){
-			draw_2();
-			colision_M_P();
-
-			if(game_over()){ // Comprueba si hemos perdido todas las vidas
-				clear(BLACK);
-				draw_GameOver();
-
-				itpms=tpms;
-				while (tpms==itpms)
-					tps();
-				itpms=tpms;
-				while (tpms==itpms)
-					tps();
-				goto begin;
+		if (hiscores_dirty){
+			hiscores_dirty = false;
+			save_hiscores();
+		}
+		if (frame){
+			u64 end = rdtsc();
+			stats_add(&sim_stats, ticks_us(end - t));
+			if (ab_run >= 0)
+				hist_add(&ab[ab_run].sim, ticks_us(end - t));
+			if (watch_over(&sim_watch, t, end)){
+				u64 parts[WATCH_PARTS] = {0}, known = 0;
+				for (u32 i = 0; i < PROF_COUNT; i++)
+					known += parts[i] = prof_time[i] - prof0[i];
+				known += parts[WATCH_PUBLISH] = pub;
+				parts[WATCH_OTHER] = end - t > known ? end - t - known : 0;
+				watch_record(&sim_watch, t, end, parts);
 			}
-			if(next_level(2)){
-				clear(BLACK);
-				draw_win();
+		}
+		stress_report();
 
-				itpms=tpms;
-				while (tpms==itpms)
-					tps();
-				itpms=tpms;
-				while (tpms==itpms)
-					tps();
+		/* Dormir hasta el siguiente evento del juego; la tarea de entrada nos
+		   despierta antes si llega una tecla */
+		task_sleep_until(sim_t0 + ms_ticks(game_next()));
+	}
+}
 
-				goto begin;
+/////////// Funcion principal del juego /////////////////
 
-			}
-		}
+/* Toma los registros del archivo de recursos abierto; retorna false si falta
+	alguno o no es usable */
+bool load_assets(void){
+	u32 size;
+
+	if (!(sprites = asset_get("sprites", &size)) || !(sprite_count = size / sizeof(struct sprite)))
+		return false;
+	if (!(strings = asset_get("strings", &size)) || !strings_valid(strings, size))
+		return false;
+	if (!(about = asset_get("about", &size)))
+		return false;
+	about_count = size / sizeof(struct text_item);
+	for (u32 i = 0; i < about_count; i++)
+		if (about[i].str >= strings->count)
+			return false;
+	if (!(pack = asset_get("levels", &size)) || !levels_valid(pack, size, sprite_count))
+		return false;
+	return true;
+}
+
+noreturn kernel_main(u32 magic, const struct multiboot_info *mbi){ 
+
+	/* La simulacion corre en este nucleo (BSP) y el renderizado en el primer
+	   AP, si el firmware reporta uno y responde al SIPI. El AP corre su propio
+	   planificador, que espera hasta que se le asigne la tarea de renderizado */
+	tribuf_init(&frame_tb);
+	serial_init();
+
+	/* Los recursos vienen del modulo "assets.bin" que carga GRUB; si no esta
+	   o no es valido se usa la copia incluida en el kernel */
+	u32 size;
+	const struct asset_archive *a;
+	multiboot_init(magic, mbi);
+	settings_parse(multiboot_cmdline());
+	report_settings();
+	if ((a = multiboot_module("assets.bin", &size)) && assets_open(a, size) && load_assets())
+		serial_puts("assets: assets.bin\r\n");
+	else if (assets_open(&builtin_assets, builtin_assets.size) && load_assets())
+		serial_puts("assets: builtin\r\n");
+	else
+		reset();
+
+	smp_init();
+	smp_start_ap(sched_run);
+	clock_calibrate();
+
+	prof_enabled = settings.prof;
+	tick_scale = settings.tick;
+	move_tick = settings.move;
+	particle_seed(settings.seed ? settings.seed : (u32) rdtsc());
+	load_hiscores();
+	if (ps2_init(KBD_TYPEMATIC))
+		serial_puts("teclado: configurado\r\n");
+	else
+		serial_puts("teclado: no respondio, se usa como lo dejo el BIOS\r\n");
+
+	/* Solo el BSP recibe el timer, que mueve el secuenciador de sonido. Sin
+	   sonido sigue corriendo para que la telemetria mida lo que cuesta */
+	irq_timer = settings.sound ? sound_tick : 0;
+	irq_init();
 
-	goto loop2_1;
+	renderer = task_create("render", render_main, 0, PRIO_NORMAL, smp_cpus - 1);
+	task_create("input", input_main, 0, PRIO_HIGH, 0);
+	sim = task_create("sim", sim_main, 0, PRIO_NORMAL, 0);
+	task_create("telemetry", telemetry_main, 0, PRIO_LOW, 0);
+	if (disk_present)
+		task_create("disk", disk_main, 0, PRIO_LOW, 0);
 
+	sched_run(0);
 }
@@ -0,0 +1,26 @@
+#include "types.h"
+#include "level.h"
+
+bool levels_valid(const struct level_pack *p, u32 size, u32 sprites){
+	if (size < sizeof(*p) || p->magic != LEVEL_MAGIC || p->version != LEVEL_VERSION || !p->count)
+		return false;
+	if (sizeof(*p) + p->count * sizeof(p->offset[0]) > size)
+		return false;
+
+	for (u32 n = 0; n < p->count; n++){
+		u32 off = p->offset[n];
+		if ((off & 3) || off + sizeof(struct level) > size)
+			return false;
+		const struct level *l = level_get(p, n);
+		if (l->size < sizeof(*l) + l->wave_count * sizeof(struct wave) || off + l->size > size)
+			return false;
+		if (!l->tick_min || l->tick_min > l->tick_ms || !l->xscale || l->wave_count > MAX_WAVES)
+			return false;
+		for (u32 w = 0; w < l->wave_count; w++){
+			const struct wave *wv = &l->wave[w];
+			if (wv->sprite >= sprites || wv->path >= PATH_COUNT || (wv->path && !wv->period))
+				return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,97 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include "types.h"
+
+/* Formato binario de los niveles (little endian, ver levels.S). Es el registro
+   "levels" del archivo de recursos y se usa tal como GRUB lo dejo en memoria:
+   el motor lee estas estructuras en su lugar, sin copiarlas ni convertirlas,
+   asi que todos los campos van alineados a su tamano y los desplazamientos son
+   relativos al inicio del registro */
+
+#define LEVEL_MAGIC   (0x4C56454C) // "LEVL"
+#define LEVEL_VERSION (4)
+
+struct level_pack{
+	u32 magic;
+	u16 version;
+	u16 count;
+	u32 offset[];	// desde el inicio del archivo hasta cada struct level
+};
+
+/* flags de struct level */
+#define LVF_SHOOT  (1 << 0) // el jugador puede disparar
+#define LVF_WELL   (1 << 1) // paredes fijas a los lados del area de juego
+#define LVF_TUNNEL (1 << 2) // tunel de paredes en zigzag que quitan vidas
+
+/* flags de struct wave */
+#define WAVE_SHOOTABLE  (1 << 0) // se destruye con una bala (+1 punto)
+#define WAVE_EXIT_LIFE  (1 << 1) // si llega al fondo se pierde una vida
+#define WAVE_EXIT_SCORE (1 << 2) // si llega al fondo se gana un punto
+
+/* Maximo de oleadas por nivel */
+#define MAX_WAVES (64)
+
+/* Trayectoria de una oleada. Sin trayectoria cada miembro sale por su lado
+   (escalonados segun stride) y se mueve solo. Con una, la oleada es una
+   formacion: salen todos juntos y cada paso la posicion de cada miembro es la
+   del ancla (que avanza v en la direccion angle) mas la columna del miembro
+   mas la trayectoria, atrasada stride pasos por miembro. Vuelve a salir
+   completa respawn_ms despues de que no quede ninguno */
+#define PATH_NONE  (0)
+#define PATH_SINE  (1) // vaiven de amp unidades con un ciclo cada period pasos
+#define PATH_DIVE  (2) // en su lugar hasta su turno, despues cae acelerando y
+                       // se abre amp unidades (medio vaiven en period pasos)
+#define PATH_COUNT (3)
+
+/* Las velocidades van en punto fijo 8.8: celdas por paso * 256 */
+
+/* Oleada: count enemigos iguales que salen escalonados o en formacion */
+struct wave{
+	u8 sprite;
+	u8 count;
+	s8 x0, dx;	// columna del miembro i: x0 + i*dx
+	s8 y0;		// fila inicial
+	u8 flags;
+	u8 release;	// paso en que sale el primer miembro
+	u8 stride;	// pasos entre un miembro y el siguiente (o atraso en la trayectoria)
+	s16 v;		// celdas que avanza por paso (8.8)
+	u16 respawn_ms;	// espera para volver a salir despues de morir
+	u8 angle;	// direccion en 1/256 de vuelta: 0 hacia abajo, 64 hacia +x
+	u8 path;	// PATH_*
+	u8 amp;		// unidades que se aparta de su columna
+	u8 period;	// pasos de la trayectoria (no 0 si hay una)
+};
+
+struct level{
+	u16 size;		// bytes, incluidas las oleadas
+	u16 tick_ms;		// ms entre pasos de la simulacion al empezar
+	u16 tick_min;		// ms entre pasos al llegar a win_score
+	u16 win_score;		// puntaje acumulado con el que se pasa el nivel
+	s16 bullet_v;		// filas que sube una bala por paso (8.8)
+	u8 flags;
+	u8 wave_count;
+	u8 x0, xscale;		// columna de pantalla de x=0 y columnas por unidad
+	s8 min_x, max_x;	// limites del jugador (niveles sin tunel)
+	s8 player_x, player_y;
+	s8 player_step;		// unidades que se mueve por tecla
+	u8 well_width;		// distancia entre las paredes fijas (unidades)
+	u8 tunnel_top, tunnel_rows;
+	u8 tunnel_min, tunnel_max;	// unidades entre las que oscila la pared izquierda
+	u8 tunnel_gap;		// distancia de la pared izquierda a la derecha
+	u8 bottom;		// ultima fila del area de juego
+	struct wave wave[];
+};
+
+_Static_assert(sizeof(struct wave) == 16, "struct wave no coincide con levels.S");
+_Static_assert(sizeof(struct level) == 26, "struct level no coincide con levels.S");
+
+/* Revisa que un registro de niveles de size bytes sea usable en su lugar y que
+   sus oleadas usen solo los sprites que hay */
+bool levels_valid(const struct level_pack *p, u32 size, u32 sprites);
+
+static inline const struct level *level_get(const struct level_pack *p, u32 n){
+	return (const struct level *) ((const u8 *) p + p->offset[n]);
+}
+
+#endif
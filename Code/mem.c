@@ -0,0 +1,37 @@
+#include "types.h"
+
+/* GCC puede generar llamadas a estas funciones aun con -ffreestanding (copias
+   de estructuras, inicializacion de arreglos), asi que el kernel las provee */
+
+void *memcpy(void *dst, const void *src, u32 n){
+	u8 *d = dst;
+	const u8 *s = src;
+	while (n--)
+		*d++ = *s++;
+	return dst;
+}
+
+void *memmove(void *dst, const void *src, u32 n){
+	u8 *d = dst;
+	const u8 *s = src;
+	if (d < s)
+		return memcpy(dst, src, n);
+	while (n--)
+		d[n] = s[n];
+	return dst;
+}
+
+void *memset(void *dst, int c, u32 n){
+	u8 *d = dst;
+	while (n--)
+		*d++ = (u8) c;
+	return dst;
+}
+
+int memcmp(const void *a, const void *b, u32 n){
+	const u8 *x = a, *y = b;
+	for (; n; n--, x++, y++)
+		if (*x != *y)
+			return *x - *y;
+	return 0;
+}
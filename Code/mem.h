@@ -0,0 +1,12 @@
+#ifndef MEM_H
+#define MEM_H
+
+#include "types.h"
+
+/* Implementadas en mem.c */
+void *memcpy(void *dst, const void *src, u32 n);
+void *memmove(void *dst, const void *src, u32 n);
+void *memset(void *dst, int c, u32 n);
+int memcmp(const void *a, const void *b, u32 n);
+
+#endif
@@ -0,0 +1,72 @@
+#include "types.h"
+#include "multiboot.h"
+
+#define MAX_MODS (8)
+#define MOD_NAME (24)
+#define CMDLINE_SIZE (256)
+
+static char cmdline[CMDLINE_SIZE];
+
+/* Copia del indice de modulos (no de su contenido) */
+static struct{
+	u32 start, end;
+	char name[MOD_NAME];
+} mods[MAX_MODS];
+static u32 mod_count;
+
+/* Copia el nombre del archivo (lo que hay despues de la ultima '/' y antes del
+   primer espacio) de la linea del modulo */
+static void copy_name(char *dst, const char *s){
+	const char *base = s;
+	for (; *s && *s != ' '; s++)
+		if (*s == '/')
+			base = s + 1;
+	u32 i = 0;
+	for (; base < s && i < MOD_NAME - 1; base++)
+		dst[i++] = *base;
+	dst[i] = 0;
+}
+
+static bool name_eq(const char *a, const char *b){
+	while (*a && *a == *b)
+		a++, b++;
+	return *a == *b;
+}
+
+void multiboot_init(u32 magic, const struct multiboot_info *mbi){
+	if (magic != MULTIBOOT_MAGIC)
+		return;
+
+	if ((mbi->flags & MB_INFO_CMDLINE) && mbi->cmdline){
+		const char *s = (const char *) mbi->cmdline;
+		for (u32 i = 0; i < CMDLINE_SIZE - 1 && s[i]; i++)
+			cmdline[i] = s[i];
+	}
+
+	if (!(mbi->flags & MB_INFO_MODS))
+		return;
+
+	const struct multiboot_mod *m = (const struct multiboot_mod *) mbi->mods_addr;
+	for (u32 i = 0; i < mbi->mods_count && mod_count < MAX_MODS; i++, mod_count++){
+		mods[mod_count].start = m[i].start;
+		mods[mod_count].end = m[i].end;
+		copy_name(mods[mod_count].name, m[i].string ? (const char *) m[i].string : "");
+	}
+}
+
+const void *multiboot_module(const char *name, u32 *size){
+	for (u32 i = 0; i < mod_count; i++)
+		if (name_eq(mods[i].name, name)){
+			*size = mods[i].end - mods[i].start;
+			return (const void *) mods[i].start;
+		}
+	return 0;
+}
+
+/* La primera palabra es la ruta del kernel; las opciones son las demas */
+const char *multiboot_cmdline(void){
+	const char *s = cmdline;
+	while (*s && *s != ' ')
+		s++;
+	return s;
+}
@@ -0,0 +1,40 @@
+#ifndef MULTIBOOT_H
+#define MULTIBOOT_H
+
+#include "types.h"
+
+/* Valor de %eax cuando un cargador multiboot (GRUB) salta a _start */
+#define MULTIBOOT_MAGIC (0x2BADB002)
+
+#define MB_INFO_CMDLINE (1 << 2)
+#define MB_INFO_MODS    (1 << 3)
+
+/* Solo los campos que se usan; el resto de la estructura sigue despues */
+struct multiboot_info{
+	u32 flags;
+	u32 mem_lower, mem_upper;
+	u32 boot_device;
+	u32 cmdline;
+	u32 mods_count, mods_addr;
+};
+
+struct multiboot_mod{
+	u32 start, end;
+	u32 string;	// linea del comando "module" en grub.cfg
+	u32 reserved;
+};
+
+/* Guarda la lista de modulos y la linea de comandos. Hay que llamarla antes
+   de escribir en memoria baja (p. ej. el trampolin de los AP), donde GRUB
+   puede haber dejado mbi */
+void multiboot_init(u32 magic, const struct multiboot_info *mbi);
+
+/* Busca un modulo por el nombre de su archivo (sin directorio) y retorna su
+   direccion tal como lo cargo GRUB, o 0. En *size deja su largo en bytes */
+const void *multiboot_module(const char *name, u32 *size);
+
+/* Opciones de la linea de comandos del kernel: lo que sigue a la ruta en la
+   linea "multiboot" de grub.cfg ("" si no hay). Las interpreta settings.c */
+const char *multiboot_cmdline(void);
+
+#endif
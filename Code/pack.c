@@ -0,0 +1,83 @@
+/* Arma el archivo de recursos (formato en asset.h). Corre en la maquina donde
+   se compila, no en el kernel.
+
+   Uso: pack salida.bin nombre=archivo [nombre=archivo ...] */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "asset.h"
+
+#define MAX_RECORDS (32)
+
+#define ALIGN_UP(n) (((n) + ASSET_ALIGN - 1) & ~(u32) (ASSET_ALIGN - 1))
+
+static u8 *read_file(const char *path, u32 *size){
+	FILE *f = fopen(path, "rb");
+	if (!f)
+		return 0;
+	fseek(f, 0, SEEK_END);
+	*size = ftell(f);
+	rewind(f);
+	u8 *data = malloc(*size ? *size : 1);
+	if (data && fread(data, 1, *size, f) != *size){
+		free(data);
+		data = 0;
+	}
+	fclose(f);
+	return data;
+}
+
+int main(int argc, char **argv){
+	static struct{
+		struct asset_archive head;
+		struct asset_entry entry[MAX_RECORDS];
+	} index;
+	u8 *data[MAX_RECORDS];
+	u32 count = argc - 2, offset;
+
+	if (argc < 3 || count > MAX_RECORDS){
+		fprintf(stderr, "uso: %s salida.bin nombre=archivo ...\n", argv[0]);
+		return 1;
+	}
+
+	offset = ALIGN_UP(sizeof(index.head) + count * sizeof(index.entry[0]));
+	for (u32 i = 0; i < count; i++){
+		struct asset_entry *e = &index.entry[i];
+		char *arg = argv[i + 2], *path = strchr(arg, '=');
+		if (!path || path - arg >= ASSET_NAME || path == arg){
+			fprintf(stderr, "%s: nombre invalido en '%s'\n", argv[0], arg);
+			return 1;
+		}
+		memcpy(e->name, arg, path - arg);
+		if (!(data[i] = read_file(++path, &e->size))){
+			fprintf(stderr, "%s: no se pudo leer '%s'\n", argv[0], path);
+			return 1;
+		}
+		e->offset = offset;
+		e->sum = asset_sum(data[i], e->size);
+		offset = ALIGN_UP(offset + e->size);
+	}
+
+	index.head.magic = ASSET_MAGIC;
+	index.head.version = ASSET_VERSION;
+	index.head.count = count;
+	index.head.size = offset;
+	index.head.sum = asset_sum(index.entry, count * sizeof(index.entry[0]));
+
+	/* Todo lo que no es cabecera, indice o registro queda en 0 */
+	u8 *out = calloc(1, offset);
+	if (!out)
+		return 1;
+	memcpy(out, &index, sizeof(index.head) + count * sizeof(index.entry[0]));
+	for (u32 i = 0; i < count; i++)
+		memcpy(out + index.entry[i].offset, data[i], index.entry[i].size);
+
+	FILE *f = fopen(argv[1], "wb");
+	if (!f || fwrite(out, 1, offset, f) != offset || fclose(f)){
+		fprintf(stderr, "%s: no se pudo escribir '%s'\n", argv[0], argv[1]);
+		return 1;
+	}
+	return 0;
+}
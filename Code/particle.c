@@ -0,0 +1,83 @@
+#include "types.h"
+#include "fixed.h"
+#include "particle.h"
+
+struct particles particles;
+
+/* Colores VGA: 1 azul, 3 cian, 4 rojo, 7 gris, 8 gris oscuro, 11 cian claro,
+   12 rojo claro, 14 amarillo, 15 blanco */
+const struct ramp_color ramp_table[RAMP_COUNT][RAMP_STEPS] = {
+	[RAMP_FIRE]   = {{'*', 14}, {'+', 12}, {'.', 4}, {'.', 8}},
+	[RAMP_THRUST] = {{'\'', 15}, {':', 11}, {'.', 3}, {'.', 1}},
+	[RAMP_DUST]   = {{'o', 7}, {'o', 8}, {'.', 7}, {'.', 8}},
+};
+
+/* Generador congruencial: basta para repartir direcciones y duraciones, y
+   con la misma semilla el benchmark siempre ve lo mismo */
+static u32 seed = 1;
+
+static inline u32 rnd(void){
+	seed = seed * 1103515245 + 12345;
+	return seed >> 16;
+}
+
+void particle_seed(u32 s){
+	seed = s;
+}
+
+void particle_emit(fixed x, fixed y, fixed vx, fixed vy, u32 steps, enum ramp r){
+	u32 i = particles.count;
+	if (i >= MAX_PARTICLES)
+		return;
+	particles.x[i] = x;
+	particles.y[i] = y;
+	particles.vx[i] = vx;
+	particles.vy[i] = vy;
+	particles.life[i] = FIX_ONE;
+	particles.decay[i] = FIX_ONE / (steps ? steps : 1);
+	particles.ramp[i] = r;
+	particles.count = i + 1;
+}
+
+/* Direcciones repartidas en la vuelta con un poco de ruido, y cada una con
+   su propia rapidez y duracion */
+void particle_burst(fixed x, fixed y, u32 n, fixed speed, u32 steps, enum ramp r){
+	for (u32 k = 0; k < n; k++){
+		u32 a = k * (FIX_ONE / n) + (rnd() & 0x7FF);
+		fixed v = fix_mul(speed, FIX_ONE / 2 + (rnd() & 0x7FFF));
+		particle_emit(x, y, fix_mul(v, fix_sin(a)), fix_mul(v, fix_cos(a)),
+			steps / 2 + rnd() % (steps / 2 + 1), r);
+	}
+}
+
+/* Primero todos los campos de corrido, sin saltos, y despues la compactacion,
+   que solo toca las que murieron */
+void particles_update(void){
+	struct particles *p = &particles;
+	u32 n = p->count;
+
+	for (u32 i = 0; i < n; i++){
+		p->x[i] += p->vx[i];
+		p->y[i] += p->vy[i];
+	}
+	for (u32 i = 0; i < n; i++){
+		p->vx[i] -= p->vx[i] >> 3;
+		p->vy[i] -= p->vy[i] >> 3;
+		p->life[i] -= p->decay[i];
+	}
+	for (u32 i = 0; i < n; ){
+		if (p->life[i] > 0){
+			i++;
+			continue;
+		}
+		n--;
+		p->x[i] = p->x[n];
+		p->y[i] = p->y[n];
+		p->vx[i] = p->vx[n];
+		p->vy[i] = p->vy[n];
+		p->life[i] = p->life[n];
+		p->decay[i] = p->decay[n];
+		p->ramp[i] = p->ramp[n];
+	}
+	p->count = n;
+}
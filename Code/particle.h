@@ -0,0 +1,62 @@
+#ifndef PARTICLE_H
+#define PARTICLE_H
+
+#include "types.h"
+#include "fixed.h"
+
+/* Particulas para explosiones y el propulsor de la nave. Van en arreglos
+   separados por campo (no un arreglo de estructuras), contiguos y sin huecos:
+   las vivas son las primeras count, asi particles_update() recorre cada
+   campo de corrido en una sola pasada. Una que muere se reemplaza por la
+   ultima */
+
+#define MAX_PARTICLES (4096)
+
+/* Cada rampa va de la particula recien nacida a la que se apaga */
+enum ramp{
+	RAMP_FIRE,	// explosion de un enemigo
+	RAMP_THRUST,	// propulsor del jugador
+	RAMP_DUST,	// choque con un meteorito
+	RAMP_COUNT
+};
+
+#define RAMP_STEPS (4)
+
+struct ramp_color{
+	char glyph;
+	u8 color;	// color de texto VGA
+};
+
+extern const struct ramp_color ramp_table[RAMP_COUNT][RAMP_STEPS];
+
+struct particles{
+	u32 count;
+	fixed x[MAX_PARTICLES], y[MAX_PARTICLES];	// unidades del nivel
+	fixed vx[MAX_PARTICLES], vy[MAX_PARTICLES];	// unidades por paso
+	fixed life[MAX_PARTICLES];	// de FIX_ONE al nacer a 0
+	fixed decay[MAX_PARTICLES];	// vida que pierde por paso
+	u8 ramp[MAX_PARTICLES];
+};
+
+extern struct particles particles;
+
+/* Color de la particula i segun lo que le queda de vida */
+static inline const struct ramp_color *particle_color(u32 i){
+	u32 s = (u32) (FIX_ONE - particles.life[i]) * RAMP_STEPS >> FIX_SHIFT;
+	return &ramp_table[particles.ramp[i]][s < RAMP_STEPS ? s : RAMP_STEPS - 1];
+}
+
+/* Cambia la semilla del generador de direcciones y duraciones */
+void particle_seed(u32 s);
+
+/* Una particula que vive steps pasos; no hace nada si el arreglo esta lleno */
+void particle_emit(fixed x, fixed y, fixed vx, fixed vy, u32 steps, enum ramp r);
+
+/* n particulas desde x, y en todas las direcciones, a lo mas a speed
+   unidades por paso, que viven entre steps/2 y steps pasos */
+void particle_burst(fixed x, fixed y, u32 n, fixed speed, u32 steps, enum ramp r);
+
+/* Un paso: mueve todas, las frena un poco y quita las que se apagaron */
+void particles_update(void);
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include "types.h"
+
+/* Lo que el nucleo del juego (game.c) necesita de la plataforma. En el kernel
+   lo da kernel.c con el hardware y en Linux bench.c */
+
+/* Contador monotono para el perfilador, en unidades de la plataforma (ciclos
+   del TSC en el kernel, ns en Linux) */
+u64 plat_time(void);
+
+#endif
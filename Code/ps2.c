@@ -0,0 +1,87 @@
+#include "types.h"
+#include "io.h"
+#include "clock.h"
+#include "ps2.h"
+
+/* Comandos del controlador */
+#define CTL_READ_CFG  (0x20)
+#define CTL_WRITE_CFG (0x60)
+#define CTL_OFF_PORT2 (0xA7)
+#define CTL_OFF_PORT1 (0xAD)
+#define CTL_ON_PORT1  (0xAE)
+
+#define CFG_IRQ1      (1 << 0)
+#define CFG_IRQ2      (1 << 1)
+#define CFG_TRANSLATE (1 << 6)
+
+/* Comandos del teclado y sus respuestas */
+#define KBD_SCANSET   (0xF0)
+#define KBD_TYPEMATIC (0xF3)
+#define KBD_ENABLE    (0xF4)
+#define KBD_DISABLE   (0xF5)
+#define KBD_ACK       (0xFA)
+#define KBD_RESEND    (0xFE)
+
+#define PS2_TIMEOUT (100)	// ms
+#define PS2_RETRIES (3)
+
+static bool wait_status(u8 bit, bool set){
+	u64 deadline = rdtsc() + ms_ticks(PS2_TIMEOUT);
+	while (((inb(PS2_STATUS) & bit) != 0) != set)
+		if (rdtsc() > deadline)
+			return false;
+	return true;
+}
+
+static bool put(u16 port, u8 b){
+	if (!wait_status(ST_IN, false))
+		return false;
+	outb(port, b);
+	return true;
+}
+
+static bool get(u8 *b){
+	if (!wait_status(ST_OUT, true))
+		return false;
+	*b = inb(PS2_DATA);
+	return true;
+}
+
+/* Un byte al teclado esperando su ACK; si pide que se reenvie se reintenta */
+static bool kbd_send(u8 b){
+	u8 r;
+	for (u32 i = 0; i < PS2_RETRIES; i++){
+		if (!put(PS2_DATA, b) || !get(&r))
+			return false;
+		if (r == KBD_ACK)
+			return true;
+		if (r != KBD_RESEND)
+			return false;
+	}
+	return false;
+}
+
+bool ps2_init(u8 typematic){
+	u8 cfg;
+
+	/* Con los puertos apagados no llega nada mientras se configura */
+	put(PS2_CMD, CTL_OFF_PORT1);
+	put(PS2_CMD, CTL_OFF_PORT2);
+	while (inb(PS2_STATUS) & ST_OUT)
+		inb(PS2_DATA);
+
+	if (!put(PS2_CMD, CTL_READ_CFG) || !get(&cfg))
+		return false;
+	cfg = (cfg & ~(CFG_IRQ1 | CFG_IRQ2)) | CFG_TRANSLATE;
+	put(PS2_CMD, CTL_WRITE_CFG);
+	put(PS2_DATA, cfg);
+	put(PS2_CMD, CTL_ON_PORT1);
+
+	bool ok = kbd_send(KBD_DISABLE) &&
+		kbd_send(KBD_SCANSET) && kbd_send(2) &&
+		kbd_send(KBD_TYPEMATIC) && kbd_send(typematic);
+	ok = kbd_send(KBD_ENABLE) && ok;	// aunque algo falle, que escanee
+	while (inb(PS2_STATUS) & ST_OUT)
+		inb(PS2_DATA);
+	return ok;
+}
@@ -0,0 +1,33 @@
+#ifndef PS2_H
+#define PS2_H
+
+#include "types.h"
+#include "io.h"
+
+/* Controlador PS/2 (8042) y teclado en el primer puerto, sin interrupciones:
+   se consulta el bit de salida llena del estado. El teclado queda en el set 2
+   con la traduccion del controlador, asi llegan codigos del set 1 (bit 7 =
+   se solto) y un 0xE0 antes de las teclas extendidas */
+
+#define PS2_DATA   (0x60)
+#define PS2_STATUS (0x64)	// al leer
+#define PS2_CMD    (0x64)	// al escribir
+
+#define ST_OUT (1 << 0)	// hay un byte para leer
+#define ST_IN  (1 << 1)	// el controlador no tomo el ultimo byte escrito
+
+/* Configura controlador y teclado: sin IRQ, traduccion, set de codigos,
+   repeticion (typematic) y escaneo habilitado. Necesita clock_calibrate()
+   para los tiempos de espera. Retorna false si el teclado no respondio; la
+   lectura igual funciona con lo que haya dejado el BIOS */
+bool ps2_init(u8 typematic);
+
+/* Si el controlador tiene un byte del teclado lo deja en *b y retorna true */
+static inline bool ps2_read(u8 *b){
+	if (!(inb(PS2_STATUS) & ST_OUT))
+		return false;
+	*b = inb(PS2_DATA);
+	return true;
+}
+
+#endif
@@ -0,0 +1,130 @@
+#include "types.h"
+#include "io.h"
+#include "clock.h"
+#include "smp.h"
+#include "sched.h"
+
+/* Definido en switch.S */
+void task_switch(u32 *save_esp, u32 load_esp);
+
+struct task tasks[MAX_TASKS];
+
+static u8 stacks[MAX_TASKS][TASK_STACK_SIZE] __attribute__((aligned(TASK_STACK_SIZE)));
+
+/* Pila del ciclo del planificador de cada nucleo y ultima tarea que corrio
+   (para repartir por turnos entre tareas de la misma prioridad) */
+static u32 sched_esp[MAX_CPUS];
+static u32 last[MAX_CPUS];
+
+/* Primera funcion que ejecuta toda tarea nueva */
+static void task_start(void){
+	struct task *t = task_current();
+	t->entry(t->arg);
+	__atomic_store_n(&t->state, TASK_DONE, __ATOMIC_RELEASE);
+	task_switch(&t->esp, sched_esp[t->cpu]);
+}
+
+struct task *task_create(const char *name, void (*entry)(void *arg), void *arg, u8 prio, u8 cpu){
+	for (u32 i = 0; i < MAX_TASKS; i++){
+		struct task *t = &tasks[i];
+		if (t->state != TASK_FREE && t->state != TASK_DONE)
+			continue;
+
+		/* Pila inicial: lo que task_switch espera sacar (edi, esi, ebx, ebp),
+		   la direccion de task_start para su ret y una direccion de retorno
+		   falsa que task_start nunca usa */
+		u32 *sp = (u32 *) &stacks[i][TASK_STACK_SIZE];
+		*--sp = 0;
+		*--sp = (u32) task_start;
+		*--sp = 0;
+		*--sp = 0;
+		*--sp = 0;
+		*--sp = 0;
+		*(struct task **) stacks[i] = t;
+
+		t->esp = (u32) sp;
+		t->prio = prio;
+		t->cpu = cpu;
+		t->wake = 0;
+		t->runtime = 0;
+		t->name = name;
+		t->entry = entry;
+		t->arg = arg;
+
+		/* El estado va al final: el planificador de otro nucleo puede estar
+		   revisando la tabla en este momento */
+		__atomic_store_n(&t->state, TASK_READY, __ATOMIC_RELEASE);
+		return t;
+	}
+	return 0;
+}
+
+/* Regresa al ciclo del planificador; la tarea sigue en el estado que dejo */
+static void task_leave(struct task *t){
+	task_switch(&t->esp, sched_esp[t->cpu]);
+}
+
+void task_yield(void){
+	task_leave(task_current());
+}
+
+void task_sleep_until(u64 deadline){
+	struct task *t = task_current();
+	t->wake = deadline;
+	__atomic_store_n(&t->state, TASK_SLEEPING, __ATOMIC_RELEASE);
+	task_leave(t);
+}
+
+void task_sleep_ms(u32 ms){
+	task_sleep_until(rdtsc() + ms_ticks(ms));
+}
+
+void task_block(void){
+	struct task *t = task_current();
+	__atomic_store_n(&t->state, TASK_BLOCKED, __ATOMIC_RELEASE);
+	task_leave(t);
+}
+
+/* Despierta una tarea dormida o bloqueada. Usa compare-and-swap porque se
+   puede llamar desde el otro nucleo */
+void task_wake(struct task *t){
+	u8 st = __atomic_load_n(&t->state, __ATOMIC_ACQUIRE);
+	while ((st == TASK_SLEEPING || st == TASK_BLOCKED) &&
+	       !__atomic_compare_exchange_n(&t->state, &st, TASK_READY, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		;
+}
+
+/* Escoge la tarea lista de mayor prioridad de este nucleo. Empieza a buscar
+   despues de la ultima que corrio, asi las de igual prioridad se turnan */
+static struct task *pick(u32 cpu, u64 now){
+	struct task *best = 0;
+	for (u32 n = 1; n <= MAX_TASKS; n++){
+		u32 i = (last[cpu] + n) % MAX_TASKS;
+		struct task *t = &tasks[i];
+		u8 st = __atomic_load_n(&t->state, __ATOMIC_ACQUIRE);
+		if (st == TASK_FREE || t->cpu != cpu)
+			continue;
+		if (st == TASK_SLEEPING && now >= t->wake &&
+		    __atomic_compare_exchange_n(&t->state, &st, TASK_READY, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+			st = TASK_READY;
+		if (st == TASK_READY && (!best || t->prio > best->prio))
+			best = t;
+	}
+	if (best)
+		last[cpu] = best - tasks;
+	return best;
+}
+
+noreturn sched_run(u32 cpu){
+	while (true){
+		struct task *t = pick(cpu, rdtsc());
+		if (!t){
+			cpu_relax();
+			continue;
+		}
+		load_begin(cpu);
+		task_switch(&sched_esp[cpu], t->esp);
+		t->runtime += rdtsc() - cpu_load[cpu].start;
+		load_end(cpu);
+	}
+}
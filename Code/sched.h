@@ -0,0 +1,64 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include "types.h"
+#include "smp.h"
+
+/* Planificador cooperativo: cada tarea tiene su propia pila y corre hasta que
+   cede el procesador (task_yield), se duerme hasta un tiempo limite del TSC
+   (task_sleep_until) o se bloquea hasta que otra tarea la despierte
+   (task_block / task_wake). Cada nucleo ejecuta solo las tareas asignadas a
+   el, asi que las colas no necesitan candados */
+
+#define MAX_TASKS (8)
+#define TASK_STACK_SIZE (8192) // potencia de 2: la pila se alinea a su tamano
+
+/* Mayor numero = mayor prioridad */
+enum task_prio{
+	PRIO_LOW = 1,
+	PRIO_NORMAL,
+	PRIO_HIGH
+};
+
+enum task_state{
+	TASK_FREE,
+	TASK_READY,
+	TASK_SLEEPING,
+	TASK_BLOCKED,
+	TASK_DONE
+};
+
+struct task{
+	u32 esp;		// pila guardada mientras no corre
+	u8 state, prio, cpu;
+	u64 wake;		// tiempo limite del TSC si esta dormida
+	u64 runtime;		// ticks que lleva ejecutando
+	const char *name;
+	void (*entry)(void *arg);
+	void *arg;
+};
+
+extern struct task tasks[MAX_TASKS];
+
+/* Crea una tarea lista para correr en el nucleo cpu. Se puede llamar aunque el
+   planificador de ese nucleo ya este corriendo */
+struct task *task_create(const char *name, void (*entry)(void *arg), void *arg, u8 prio, u8 cpu);
+
+/* La tarea que esta corriendo. La primera palabra de cada pila apunta a su
+   tarea, asi que basta con redondear %esp hacia abajo */
+static inline struct task *task_current(void){
+	u32 esp;
+	asm("movl %%esp, %0" : "=r" (esp));
+	return *(struct task **) (esp & ~(TASK_STACK_SIZE - 1));
+}
+
+void task_yield(void);
+void task_sleep_until(u64 deadline);
+void task_sleep_ms(u32 ms);
+void task_block(void);
+void task_wake(struct task *t);
+
+/* Ciclo del planificador de un nucleo; nunca retorna */
+noreturn sched_run(u32 cpu);
+
+#endif
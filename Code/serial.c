@@ -0,0 +1,38 @@
+#include "types.h"
+#include "io.h"
+#include "serial.h"
+
+#define COM1 (0x3F8)
+
+#define LSR_THRE (0x20) // FIFO de transmision vacia
+#define FIFO_SIZE (16)
+
+static char buf[SERIAL_BUF_SIZE];
+static u32 head, tail;	// head: siguiente a escribir, tail: siguiente a enviar
+
+void serial_init(void){
+	outb(COM1 + 1, 0x00);	// sin interrupciones
+	outb(COM1 + 3, 0x80);	// DLAB para fijar el divisor
+	outb(COM1 + 0, 0x01);	// 115200 baudios
+	outb(COM1 + 1, 0x00);
+	outb(COM1 + 3, 0x03);	// 8 bits, sin paridad, 1 bit de parada
+	outb(COM1 + 2, 0xC7);	// FIFO habilitada y limpia, 14 bytes
+	outb(COM1 + 4, 0x03);	// DTR + RTS
+}
+
+/* Si el buffer se llena el resto del texto se descarta */
+void serial_puts(const char *s){
+	for (; *s; s++){
+		if (head - tail == SERIAL_BUF_SIZE)
+			return;
+		buf[head++ & (SERIAL_BUF_SIZE - 1)] = *s;
+	}
+}
+
+/* Con la FIFO vacia caben FIFO_SIZE bytes sin esperar */
+bool serial_flush(void){
+	if (inb(COM1 + 5) & LSR_THRE)
+		for (u32 n = 0; n < FIFO_SIZE && tail != head; n++)
+			outb(COM1, buf[tail++ & (SERIAL_BUF_SIZE - 1)]);
+	return tail == head;
+}
@@ -0,0 +1,18 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include "types.h"
+
+/* Salida por el puerto serie COM1 (115200 8N1). serial_puts solo copia a un
+   buffer circular; los bytes salen cuando alguien llama serial_flush, que
+   escribe mientras el UART tenga espacio y nunca espera */
+
+#define SERIAL_BUF_SIZE (4096) // potencia de 2
+
+void serial_init(void);
+void serial_puts(const char *s);
+
+/* Retorna true si el buffer quedo vacio */
+bool serial_flush(void);
+
+#endif
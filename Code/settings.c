@@ -0,0 +1,128 @@
+#include "types.h"
+#include "config.h"
+#include "serial.h"
+#include "settings.h"
+
+struct settings settings = {
+	.tick = TICK_SCALE,
+	.fps = RENDER_FPS,
+	.vsync = VSYNC,
+	.seed = SEED,
+	.move = MOVE_TICK,
+	.stress = 0,
+	.prof = PROFILER,
+	.sound = SOUND,
+	.bench = false,
+	.soundab = false,
+};
+
+const struct setting setting_table[] = {
+	{"tick",   SETTING_U32,  &settings.tick,   10, 1000, TICK_SCALE},
+	{"fps",    SETTING_U32,  &settings.fps,    0, 1000, RENDER_FPS},
+	{"vsync",  SETTING_BOOL, &settings.vsync,  0, 1, 1},
+	{"seed",   SETTING_U32,  &settings.seed,   0, 0xFFFFFFFF, SEED},
+	{"move",   SETTING_U32,  &settings.move,   10, 1000, MOVE_TICK},
+	{"stress", SETTING_U32,  &settings.stress, 0, 16, STRESS_STEPS},
+	{"prof",   SETTING_BOOL, &settings.prof,   0, 1, 1},
+	{"sound",  SETTING_BOOL, &settings.sound,  0, 1, 1},
+	{"bench",  SETTING_BOOL, &settings.bench,  0, 1, 1},
+	{"soundab", SETTING_BOOL, &settings.soundab, 0, 1, 1},
+};
+
+const u32 setting_count = sizeof(setting_table) / sizeof(setting_table[0]);
+
+u32 setting_get(const struct setting *s){
+	return s->type == SETTING_BOOL ? *(bool *) s->value : *(u32 *) s->value;
+}
+
+/* Compara la palabra [s, e) con name */
+static bool word_eq(const char *s, const char *e, const char *name){
+	while (s < e && *name && *s == *name)
+		s++, name++;
+	return s == e && !*name;
+}
+
+/* Decimal sin signo; false si hay otra cosa o no cabe en 32 bits */
+static bool parse_u32(const char *s, const char *e, u32 *v){
+	u32 n = 0;
+	if (s == e)
+		return false;
+	for (; s < e; s++){
+		if (*s < '0' || *s > '9' || n > (0xFFFFFFFF - (*s - '0')) / 10)
+			return false;
+		n = n * 10 + (*s - '0');
+	}
+	*v = n;
+	return true;
+}
+
+static void warn(const char *msg, const char *s, const char *e){
+	char word[32];
+	u32 i = 0;
+	for (; s < e && i < sizeof(word) - 1; s++)
+		word[i++] = *s;
+	word[i] = 0;
+	serial_puts("config: ");
+	serial_puts(msg);
+	serial_puts(word);
+	serial_puts("\r\n");
+}
+
+/* Una opcion "nombre" o "nombre=valor" en [s, e) */
+static void parse_option(const char *s, const char *e){
+	const char *eq = s;
+	while (eq < e && *eq != '=')
+		eq++;
+
+	for (u32 i = 0; i < setting_count; i++){
+		const struct setting *t = &setting_table[i];
+		if (!word_eq(s, eq, t->name))
+			continue;
+		u32 v = t->bare;
+		if (eq < e && (!parse_u32(eq + 1, e, &v) || v < t->min || v > t->max)){
+			warn("valor invalido: ", s, e);
+			return;
+		}
+		if (t->type == SETTING_BOOL)
+			*(bool *) t->value = v;
+		else
+			*(u32 *) t->value = v;
+		return;
+	}
+	warn("opcion desconocida: ", s, e);
+}
+
+void settings_parse(const char *cmdline){
+	const char *s = cmdline;
+	while (*s){
+		while (*s == ' ')
+			s++;
+		const char *e = s;
+		while (*e && *e != ' ')
+			e++;
+		if (e > s)
+			parse_option(s, e);
+		s = e;
+	}
+
+	/* La comparacion de sonido juega dos veces la misma prueba de carga */
+	if (settings.soundab){
+		if (!settings.stress)
+			settings.stress = STRESS_STEPS;
+		if (!settings.seed)
+			settings.seed = 1;
+	}
+
+	/* El benchmark siempre mide la misma prueba de carga, sin esperar al
+	   monitor ni tocar el parlante */
+	if (settings.bench){
+		if (!settings.stress)
+			settings.stress = STRESS_STEPS;
+		if (!settings.seed)
+			settings.seed = 1;
+		settings.fps = 0;
+		settings.vsync = false;
+		settings.sound = false;
+		settings.prof = true;
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include "types.h"
+
+/* Ajustes de la linea de comandos del kernel (lo que sigue a la ruta en la
+   linea "multiboot" de grub.cfg), p. ej. "fps=30 vsync seed=7 stress=6".
+   Cada uno tiene tipo, rango y valor por omision de config.h. Un booleano
+   solo es "nombre" o "nombre=0|1"; un numero sin valor toma el que dice la
+   tabla. Se leen una vez al arrancar, antes de crear las tareas; lo que usan
+   los ciclos internos (dimensiones, puntajes, presupuestos) sigue en
+   config.h como constante */
+
+struct settings{
+	u32 tick;	// duracion del paso en % de la del nivel
+	u32 fps;	// cuadros por segundo como maximo (0 = sin limite)
+	bool vsync;	// presentar al empezar el retrazado vertical
+	u32 seed;	// semilla de particulas (0 = del TSC)
+	u32 move;	// ms entre movimientos al sostener una direccion
+	u32 stress;	// pasos de la prueba de carga (0 = no se hace)
+	bool prof;	// perfilador por subsistema
+	bool sound;
+	bool bench;	// prueba de carga reproducible y sin limites de cuadro
+	bool soundab;	// prueba de carga sin y con sonido, para compararlas
+};
+
+extern struct settings settings;
+
+enum setting_type{
+	SETTING_BOOL,
+	SETTING_U32
+};
+
+struct setting{
+	const char *name;
+	u8 type;
+	void *value;
+	u32 min, max;
+	u32 bare;	// valor si aparece sin "="
+};
+
+extern const struct setting setting_table[];
+extern const u32 setting_count;
+
+/* Aplica las opciones de cmdline sobre los valores por omision. Las que no
+   existen o estan fuera de rango se ignoran y se avisan por el puerto serie */
+void settings_parse(const char *cmdline);
+
+/* Valor de un ajuste como u32, para mostrarlo */
+u32 setting_get(const struct setting *s);
+
+#endif
@@ -0,0 +1,188 @@
+#include "types.h"
+#include "io.h"
+#include "irq.h"
+#include "smp.h"
+#include "mem.h"
+
+/* Registros del APIC local (desplazamientos en bytes) */
+#define LAPIC_ID     (0x020)
+#define LAPIC_SVR    (0x0F0)
+#define LAPIC_ICR_LO (0x300)
+#define LAPIC_ICR_HI (0x310)
+
+#define ICR_INIT     (0x00004500) // INIT, nivel afirmado
+#define ICR_STARTUP  (0x00004600) // SIPI, el vector va en los bits 0-7
+#define ICR_PENDING  (1 << 12)    // Estado de entrega
+
+/* Direccion fisica (por debajo de 1 MiB y alineada a 4 KiB) donde se copia el
+   codigo de arranque de 16 bits de los AP. El vector del SIPI es la pagina */
+#define AP_TRAMPOLINE (0x8000)
+
+u32 smp_cpus = 1;
+struct cpu_load cpu_load[MAX_CPUS];
+
+static volatile u32 *lapic = (volatile u32 *) 0xFEE00000;
+static u8 bsp_id;
+static u8 apic_ids[8];
+static u32 apic_count;
+
+/* Definidos en trampoline.S */
+extern const u8 ap_tramp_start[], ap_tramp_end[];
+
+/* Los usa trampoline.S para dar pila y punto de entrada al AP */
+u32 ap_stack_top;
+static void (*ap_entry)(u32 cpu);
+static volatile u32 ap_online;
+
+static u8 ap_stack[MAX_CPUS - 1][AP_STACK_SIZE] __attribute__((aligned(16)));
+
+static inline u32 lapic_read(u32 reg){
+	return lapic[reg / 4];
+}
+
+static inline void lapic_write(u32 reg, u32 v){
+	lapic[reg / 4] = v;
+}
+
+/* Espera us microsegundos (maximo ~54 ms) con el canal 2 del PIT en modo 0.
+   Se usa antes de que el TSC este calibrado */
+static void pit_wait(u32 us){
+	u32 count = us * 1193 / 1000;
+	outb(0x61, (inb(0x61) & 0xFD) | 0x01); // compuerta encendida, parlante apagado
+	outb(0x43, 0xB0);                       // canal 2, lo/hi, modo 0
+	outb(0x42, count & 0xFF);
+	outb(0x42, count >> 8);
+	while (!(inb(0x61) & 0x20))
+		cpu_relax();
+}
+
+/* ACPI */
+
+struct acpi_sdt{
+	char sig[4];
+	u32 length;
+	u8 revision, checksum;
+	char oem[6], oem_table[8];
+	u32 oem_rev, creator, creator_rev;
+} __attribute__((packed));
+
+static bool sig_eq(const void *p, const char *s, u32 n){
+	const char *c = p;
+	while (n--)
+		if (*c++ != *s++)
+			return false;
+	return true;
+}
+
+static bool checksum_ok(const u8 *p, u32 len){
+	u8 sum = 0;
+	while (len--)
+		sum += *p++;
+	return sum == 0;
+}
+
+static const u8 *scan_rsdp(u32 from, u32 to){
+	for (; from < to; from += 16){
+		const u8 *p = (const u8 *) from;
+		if (sig_eq(p, "RSD PTR ", 8) && checksum_ok(p, 20))
+			return p;
+	}
+	return 0;
+}
+
+/* El RSDP esta en el primer KiB del EBDA o en el area de BIOS 0xE0000-0xFFFFF */
+static const u8 *find_rsdp(void){
+	const u16 *bda = (const u16 *) 0x40E;
+	asm("" : "+r" (bda)); // direccion baja valida; evita el aviso de puntero nulo de GCC
+	u32 ebda = (u32) *bda << 4;
+	const u8 *rsdp = 0;
+	if (ebda)
+		rsdp = scan_rsdp(ebda, ebda + 1024);
+	if (!rsdp)
+		rsdp = scan_rsdp(0xE0000, 0x100000);
+	return rsdp;
+}
+
+static void parse_madt(const struct acpi_sdt *madt){
+	const u8 *p = (const u8 *) madt + 44;
+	const u8 *end = (const u8 *) madt + madt->length;
+
+	lapic = (volatile u32 *) *(const u32 *) ((const u8 *) madt + 36);
+	for (; p + 2 <= end && p[1]; p += p[1]){
+		/* Tipo 0: APIC local de un procesador. Bit 0 de flags = habilitado */
+		if (p[0] == 0 && (p[4] & 1) && apic_count < sizeof(apic_ids))
+			apic_ids[apic_count++] = p[3];
+	}
+}
+
+u32 smp_init(void){
+	const u8 *rsdp = find_rsdp();
+	if (rsdp){
+		const struct acpi_sdt *rsdt = (const struct acpi_sdt *) *(const u32 *) (rsdp + 16);
+		if (sig_eq(rsdt->sig, "RSDT", 4)){
+			const u32 *entry = (const u32 *) (rsdt + 1);
+			u32 n = (rsdt->length - sizeof(*rsdt)) / 4;
+			for (u32 i = 0; i < n; i++){
+				const struct acpi_sdt *t = (const struct acpi_sdt *) entry[i];
+				if (sig_eq(t->sig, "APIC", 4) && checksum_ok((const u8 *) t, t->length)){
+					parse_madt(t);
+					break;
+				}
+			}
+		}
+	}
+
+	/* Habilitar el APIC local (bit 8 del registro de vector espurio); sus
+	   espurias van a IRQ_LAPIC_SPURIOUS, que tiene compuerta (irq.c) */
+	lapic_write(LAPIC_SVR, (lapic_read(LAPIC_SVR) & ~0xFF) | 0x100 | IRQ_LAPIC_SPURIOUS);
+	bsp_id = lapic_read(LAPIC_ID) >> 24;
+	return apic_count;
+}
+
+static void send_ipi(u8 apic, u32 cmd){
+	lapic_write(LAPIC_ICR_HI, (u32) apic << 24);
+	lapic_write(LAPIC_ICR_LO, cmd);
+	while (lapic_read(LAPIC_ICR_LO) & ICR_PENDING)
+		cpu_relax();
+}
+
+/* Punto de entrada en C de los AP, llamado desde trampoline.S */
+void ap_main(void){
+	void (*entry)(u32) = ap_entry;
+	irq_load_idt();	// la llena el BSP en irq_init; aca solo sirve para excepciones
+	__atomic_store_n(&ap_online, 1, __ATOMIC_RELEASE);
+	entry(1);
+	while (true)
+		asm volatile("cli; hlt");
+}
+
+bool smp_start_ap(void (*entry)(u32 cpu)){
+	u32 i;
+	for (i = 0; i < apic_count; i++)
+		if (apic_ids[i] != bsp_id)
+			break;
+	if (i == apic_count)
+		return false;
+
+	memcpy((void *) AP_TRAMPOLINE, ap_tramp_start, ap_tramp_end - ap_tramp_start);
+	ap_stack_top = (u32) &ap_stack[0][AP_STACK_SIZE];
+	ap_entry = entry;
+	ap_online = 0;
+
+	/* Secuencia INIT - SIPI - SIPI de Intel */
+	send_ipi(apic_ids[i], ICR_INIT);
+	pit_wait(10000);
+	for (u32 s = 0; s < 2 && !ap_online; s++){
+		send_ipi(apic_ids[i], ICR_STARTUP | (AP_TRAMPOLINE >> 12));
+		pit_wait(200);
+	}
+
+	/* Dar hasta ~100 ms al AP para reportarse */
+	for (u32 t = 0; t < 100 && !__atomic_load_n(&ap_online, __ATOMIC_ACQUIRE); t++)
+		pit_wait(1000);
+	if (!ap_online)
+		return false;
+
+	smp_cpus = 2;
+	return true;
+}
@@ -0,0 +1,61 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include "types.h"
+#include "io.h"
+
+/* Maximo de nucleos que se usan (simulacion + renderizado) */
+#define MAX_CPUS (2)
+
+/* Tamano de la pila de cada AP */
+#define AP_STACK_SIZE (16384)
+
+/* Numero de nucleos en linea (1 si no hay ACPI/MADT o el AP no arranco) */
+extern u32 smp_cpus;
+
+/* Lee la tabla MADT de ACPI y habilita el APIC local del BSP. Retorna el
+   numero de procesadores habilitados que reporta el firmware */
+u32 smp_init(void);
+
+/* Arranca el primer AP con INIT/SIPI y lo pone a ejecutar entry(1) con su
+   propia pila. Retorna true si el AP respondio */
+bool smp_start_ap(void (*entry)(u32 cpu));
+
+/* Utilizacion por nucleo: ticks ocupados dentro de una ventana de tiempo. Cada
+   nucleo solo escribe su propia entrada; los demas solo leen percent */
+struct cpu_load{
+	u64 window;	// inicio de la ventana actual
+	u64 start;	// inicio del trabajo en curso
+	u64 busy;	// ticks ocupados en la ventana
+	u8 percent;	// utilizacion de la ultima ventana cerrada
+};
+
+extern struct cpu_load cpu_load[MAX_CPUS];
+
+/* Largo de la ventana de medicion en ticks del TSC */
+#define LOAD_WINDOW (1ULL << 28)
+
+static inline void load_begin(u32 cpu){
+	cpu_load[cpu].start = rdtsc();
+}
+
+/* Cierra un bloque de trabajo y, si paso la ventana, calcula el porcentaje.
+   Se escalan los valores a 32 bits para no depender de division de 64 bits */
+static inline void load_end(u32 cpu){
+	struct cpu_load *l = &cpu_load[cpu];
+	u64 now = rdtsc();
+	l->busy += now - l->start;
+	u64 elapsed = now - l->window;
+	if (elapsed >= LOAD_WINDOW){
+		u64 busy = l->busy;
+		while (elapsed >> 24){
+			elapsed >>= 1;
+			busy >>= 1;
+		}
+		l->percent = (u8) (((u32) busy * 100) / (u32) elapsed);
+		l->window = now;
+		l->busy = 0;
+	}
+}
+
+#endif
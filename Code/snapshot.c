@@ -0,0 +1,121 @@
+#include "types.h"
+#include "snapshot.h"
+
+#define MASK (SNAP_RING - 1)
+
+/* Para comparar de a 4 bytes sobre arreglos de u8 en cualquier posicion */
+typedef u32 __attribute__((may_alias, aligned(1))) word;
+
+static inline u32 get16(const struct snap_ring *r, u32 at){
+	return r->ring[at & MASK] | r->ring[(at + 1) & MASK] << 8;
+}
+
+static inline void put16(struct snap_ring *r, u32 at, u32 v){
+	r->ring[at & MASK] = v;
+	r->ring[(at + 1) & MASK] = v >> 8;
+}
+
+void snap_reset(struct snap_ring *r, const u8 *image, u32 size){
+	r->size = size < SNAP_MAX_IMAGE ? size : SNAP_MAX_IMAGE;
+	r->head = r->tail = r->count = 0;
+	for (u32 i = 0; i < r->size; i++)
+		r->last[i] = image[i];
+}
+
+/* Escritor que avanza sobre el anillo y va sacando los registros mas viejos
+   a medida que necesita lugar. Si ni sacandolos todos cabe, sigue de largo
+   sin escribir (pero el llamador igual actualiza r->last) */
+struct writer{
+	struct snap_ring *r;
+	u32 pos;
+	bool full;
+};
+
+static inline void emit(struct writer *w, u8 b){
+	struct snap_ring *r = w->r;
+	while (!w->full && w->pos + 1 - r->tail > SNAP_RING){
+		if (r->tail == r->head)
+			w->full = true;
+		else{
+			r->tail += get16(r, r->tail);
+			r->count--;
+		}
+	}
+	if (!w->full)
+		r->ring[w->pos & MASK] = b;
+	w->pos++;
+}
+
+static inline void emit_varint(struct writer *w, u32 v){
+	while (v >= 0x80){
+		emit(w, v | 0x80);
+		v >>= 7;
+	}
+	emit(w, v);
+}
+
+/* Las partes iguales se saltan de a 4 bytes mientras se pueda */
+u32 snap_push(struct snap_ring *r, const u8 *image){
+	struct writer w = {r, r->head + 2, false};
+	u8 *last = r->last;
+	u32 i = 0, n = r->size;
+
+	while (i < n){
+		u32 z = i;
+		while (i + 4 <= n && *(const word *) (image + i) == *(const word *) (last + i))
+			i += 4;
+		while (i < n && image[i] == last[i])
+			i++;
+		if (i == n)
+			break;
+		u32 l = i;
+		while (i < n && image[i] != last[i])
+			i++;
+		emit_varint(&w, l - z);
+		emit_varint(&w, i - l);
+		for (u32 k = l; k < i; k++){
+			emit(&w, image[k] ^ last[k]);
+			last[k] = image[k];
+		}
+	}
+	u32 len = w.pos + 2 - r->head;
+	emit(&w, len);
+	emit(&w, len >> 8);
+	r->pushes++;
+	if (w.full || len > 0xFFFF){
+		r->head = r->tail = w.pos;
+		r->count = 0;
+		return 0;
+	}
+	put16(r, r->head, len);
+	r->head = w.pos;
+	r->count++;
+	r->bytes += len;
+	return len;
+}
+
+static inline u32 read_varint(const struct snap_ring *r, u32 *at){
+	u32 v = 0;
+	for (u32 s = 0; ; s += 7){
+		u8 b = r->ring[(*at)++ & MASK];
+		v |= (u32) (b & 0x7F) << s;
+		if (!(b & 0x80))
+			return v;
+	}
+}
+
+u32 snap_rewind(struct snap_ring *r, u32 n){
+	u32 done = 0;
+	for (; done < n && r->count; done++){
+		u32 len = get16(r, r->head - 2);
+		u32 start = r->head - len, end = r->head - 2, at = start + 2, i = 0;
+		while (at < end){
+			i += read_varint(r, &at);
+			for (u32 k = read_varint(r, &at); k; k--, i++)
+				r->last[i] ^= r->ring[at++ & MASK];
+		}
+		r->head = start;
+		r->count--;
+	}
+	return done;
+}
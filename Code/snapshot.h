@@ -0,0 +1,42 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "types.h"
+
+/* Historia de imagenes de estado (bytes empacados, todas del mismo tamano)
+   para rebobinar. No se guardan las imagenes sino la diferencia de cada una
+   con la anterior: el xor de ambas, con las corridas de ceros comprimidas.
+   Como el xor es su propio inverso, desde la ultima imagen (que si se guarda
+   completa) se puede volver atras aplicando las diferencias de la mas nueva a
+   la mas vieja, sin imagenes clave. Las diferencias van en un anillo de
+   SNAP_RING bytes; cuando se llena se pierden las mas viejas.
+
+   Cada registro: u16 largo, pares (ceros, distintos) en varint seguidos de
+   los bytes distintos ya en xor, y u16 largo otra vez para recorrer hacia
+   atras */
+
+#define SNAP_RING (32768)	// potencia de 2
+#define SNAP_MAX_IMAGE (96 * 1024)
+
+struct snap_ring{
+	u32 size;		// bytes de cada imagen
+	u32 head, tail;		// posiciones absolutas en el anillo
+	u32 count;		// diferencias guardadas
+	u32 pushes;		// imagenes agregadas en total (estadistica)
+	u64 bytes;		// bytes de diferencias escritos en total (estadistica)
+	u8 last[SNAP_MAX_IMAGE];	// la imagen mas nueva
+	u8 ring[SNAP_RING];
+};
+
+/* Empieza una historia nueva con image como unica imagen */
+void snap_reset(struct snap_ring *r, const u8 *image, u32 size);
+
+/* Agrega image (de r->size bytes) y retorna los bytes que ocupo su diferencia;
+   0 si no cupo en el anillo, que entonces queda vacio */
+u32 snap_push(struct snap_ring *r, const u8 *image);
+
+/* Vuelve hasta n imagenes atras; retorna cuantas retrocedio. La imagen
+   queda en r->last */
+u32 snap_rewind(struct snap_ring *r, u32 n);
+
+#endif
@@ -0,0 +1,55 @@
+#include "types.h"
+#include "io.h"
+#include "irq.h"
+#include "sound.h"
+
+#define PIT_CH2  (0x42)
+#define PIT_CMD  (0x43)
+#define PIT_HZ   (1193182)
+#define SPEAKER  (0x61)	// bit 0 compuerta del canal 2, bit 1 parlante
+
+/* Estado del secuenciador; solo lo cambia sound_play con interrupciones
+   deshabilitadas y el manejador */
+static const struct note *next;	// siguiente nota, 0 si no suena nada
+static u32 left;		// ticks que le quedan a la nota actual
+static u8 playing;		// prioridad de lo que suena
+
+static void tone(u16 hz){
+	if (!hz){
+		outb(SPEAKER, inb(SPEAKER) & ~3);
+		return;
+	}
+	u16 div = PIT_HZ / hz;
+	outb(PIT_CMD, 0xB6);	// canal 2, byte bajo y alto, onda cuadrada
+	outb(PIT_CH2, div);
+	outb(PIT_CH2, div >> 8);
+	outb(SPEAKER, inb(SPEAKER) | 3);
+}
+
+void sound_play(const struct note *notes, u8 prio){
+	u32 flags = irq_save();
+	if (!next || prio >= playing){
+		next = notes;
+		left = 0;
+		playing = prio;
+	}
+	irq_restore(flags);
+}
+
+bool sound_busy(void){
+	return next != 0;
+}
+
+/* Solo toca el hardware cuando cambia la nota */
+void sound_tick(void){
+	if (!next || (left && --left))
+		return;
+	if (!next->ms){
+		tone(0);
+		next = 0;
+		return;
+	}
+	tone(next->hz);
+	left = (next->ms * IRQ_HZ + 999) / 1000;
+	next++;
+}
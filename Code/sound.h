@@ -0,0 +1,26 @@
+#ifndef SOUND_H
+#define SOUND_H
+
+#include "types.h"
+
+/* Secuenciador para el parlante del PC: toca listas de notas con el canal 2
+   del PIT y la compuerta del puerto 0x61. Los cambios de nota los hace
+   sound_tick() desde la interrupcion del timer (irq.h), asi que tocar no le
+   cuesta nada a ninguna tarea; sound_play() solo cambia un puntero */
+
+struct note{
+	u16 hz;		// 0 = silencio
+	u16 ms;		// 0 = fin de la lista
+};
+
+/* Empieza a tocar notes si no suena nada o si prio es al menos la de lo que
+   esta sonando; si no, se descarta */
+void sound_play(const struct note *notes, u8 prio);
+
+/* Si hay algo sonando (se lee sin sincronizar) */
+bool sound_busy(void);
+
+/* Avanza un tick de IRQ_HZ; va en irq_timer */
+void sound_tick(void);
+
+#endif
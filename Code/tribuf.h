@@ -0,0 +1,41 @@
+#ifndef TRIBUF_H
+#define TRIBUF_H
+
+#include "types.h"
+
+/* Triple buffer sin candados para pasar cuadros de un productor (simulacion) a
+   un consumidor (renderizador) que corren en nucleos distintos. Cada lado es
+   dueno de un indice; el tercero ("medio") se intercambia atomicamente. El bit
+   TRIBUF_FRESH en el medio indica que el productor publico un cuadro que el
+   consumidor aun no ha tomado. Ninguno de los dos lados espera al otro: el
+   productor siempre tiene donde escribir y el consumidor siempre pinta el cuadro
+   mas reciente */
+
+#define TRIBUF_FRESH (4)
+
+struct tribuf{
+	u32 back;	// indice del productor
+	u32 middle;	// indice compartido | TRIBUF_FRESH
+	u32 front;	// indice del consumidor
+};
+
+static inline void tribuf_init(struct tribuf *t){
+	t->back = 0;
+	t->middle = 1;
+	t->front = 2;
+}
+
+/* Entrega el buffer de atras y toma el del medio para el siguiente cuadro */
+static inline void tribuf_publish(struct tribuf *t){
+	t->back = __atomic_exchange_n(&t->middle, t->back | TRIBUF_FRESH, __ATOMIC_ACQ_REL) & 3;
+}
+
+/* Retorna true si hay un cuadro nuevo, que queda en t->front */
+static inline bool tribuf_acquire(struct tribuf *t){
+	if (!(__atomic_load_n(&t->middle, __ATOMIC_ACQUIRE) & TRIBUF_FRESH))
+		return false;
+	t->front = __atomic_exchange_n(&t->middle, t->front, __ATOMIC_ACQ_REL) & 3;
+	return true;
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef TYPES_H
+#define TYPES_H
+
+typedef unsigned char       u8;  //varable de 8 bits sin bit reservado para signo
+typedef signed char         s8;  //varable con bit reservado para signo
+typedef unsigned short      u16; //Variable de 16 bits sin signo
+typedef signed short        s16;
+typedef unsigned int        u32;
+typedef signed int          s32;
+typedef unsigned long long  u64; // Variable de 64 bits sin bit de signo
+typedef signed long long    s64;
+typedef unsigned long       uptr; // entero del tamano de un puntero
+
+#define noreturn __attribute__((noreturn)) void
+
+typedef enum bool {
+	false,
+	true
+}bool;
+
+#endif
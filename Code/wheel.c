@@ -0,0 +1,132 @@
+#include "types.h"
+#include "wheel.h"
+
+#define SLOT(ms) ((ms) & (WHEEL_SLOTS - 1))
+
+/* Marca en prev de los temporizadores que ya salieron de su ranura y estan por
+   llamarse dentro de wheel_advance */
+#define FIRING (WHEEL_NONE - 1)
+
+static void release(struct wheel *w, u16 i){
+	w->t[i].fn = 0;
+	w->t[i].gen++;
+	w->t[i].next = w->free;
+	w->free = i;
+}
+
+static void unlink(struct wheel *w, u16 i){
+	struct wheel_timer *t = &w->t[i];
+	u32 s = SLOT(t->expires);
+	if (t->prev != WHEEL_NONE)
+		w->t[t->prev].next = t->next;
+	else
+		w->head[s] = t->next;
+	if (t->next != WHEEL_NONE)
+		w->t[t->next].prev = t->prev;
+	if (w->head[s] == WHEEL_NONE)
+		w->busy[s / 32] &= ~(1u << (s % 32));
+}
+
+void wheel_init(struct wheel *w, u32 now){
+	w->now = now;
+	w->free = WHEEL_NONE;
+	for (u32 s = 0; s < WHEEL_SLOTS; s++)
+		w->head[s] = WHEEL_NONE;
+	for (u32 s = 0; s < WHEEL_SLOTS / 32; s++)
+		w->busy[s] = 0;
+	for (u32 i = WHEEL_TIMERS; i--; ){
+		w->t[i].gen = 0;
+		release(w, i);
+	}
+}
+
+/* Un temporizador que esta por llamarse no se puede sacar de la lista de
+   wheel_advance; solo se le quita la funcion para que no se llame */
+static void disarm(struct wheel *w, u16 i){
+	if (w->t[i].prev == FIRING){
+		w->t[i].fn = 0;
+		return;
+	}
+	unlink(w, i);
+	release(w, i);
+}
+
+void wheel_clear(struct wheel *w){
+	for (u32 i = 0; i < WHEEL_TIMERS; i++)
+		if (w->t[i].fn)
+			disarm(w, i);
+}
+
+timer_id wheel_schedule(struct wheel *w, u32 ms, timer_fn fn, void *arg){
+	u16 i = w->free;
+	if (i == WHEEL_NONE)
+		return 0;
+	w->free = w->t[i].next;
+
+	struct wheel_timer *t = &w->t[i];
+	t->expires = w->now + (ms ? ms : 1);
+	t->fn = fn;
+	t->arg = arg;
+
+	u32 s = SLOT(t->expires);
+	t->prev = WHEEL_NONE;
+	t->next = w->head[s];
+	if (t->next != WHEEL_NONE)
+		w->t[t->next].prev = i;
+	w->head[s] = i;
+	w->busy[s / 32] |= 1u << (s % 32);
+
+	return ((u32) t->gen << 16) | (i + 1);
+}
+
+bool wheel_cancel(struct wheel *w, timer_id id){
+	u32 i = (id & 0xFFFF) - 1;
+	if (i >= WHEEL_TIMERS || w->t[i].gen != (id >> 16) || !w->t[i].fn)
+		return false;
+	disarm(w, i);
+	return true;
+}
+
+void wheel_advance(struct wheel *w, u32 now){
+	while ((s32) (now - w->now) > 0){
+		u32 s = SLOT(++w->now);
+		if (!(w->busy[s / 32] & (1u << (s % 32))))
+			continue;
+
+		/* Primero se sacan de la ranura los que vencen (los demas son de
+		   vueltas posteriores) y despues se llaman. Asi un callback puede
+		   programar o cancelar cualquier cosa sin romper el recorrido */
+		u16 fire = WHEEL_NONE;
+		for (u16 i = w->head[s], nx; i != WHEEL_NONE; i = nx){
+			nx = w->t[i].next;
+			if ((s32) (w->t[i].expires - w->now) <= 0){
+				unlink(w, i);
+				w->t[i].prev = FIRING;
+				w->t[i].next = fire;
+				fire = i;
+			}
+		}
+		while (fire != WHEEL_NONE){
+			u16 i = fire;
+			timer_fn fn = w->t[i].fn;
+			void *arg = w->t[i].arg;
+			fire = w->t[i].next;
+			release(w, i);
+			if (fn)
+				fn(arg);
+		}
+	}
+}
+
+u32 wheel_next(const struct wheel *w){
+	for (u32 d = 1; d <= WHEEL_SLOTS; ){
+		u32 s = SLOT(w->now + d);
+		u32 bits = w->busy[s / 32] >> (s % 32);
+		if (bits){
+			d += __builtin_ctz(bits);
+			return d < WHEEL_SLOTS ? d : WHEEL_SLOTS;
+		}
+		d += 32 - s % 32;
+	}
+	return WHEEL_SLOTS;
+}
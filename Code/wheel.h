@@ -0,0 +1,57 @@
+#ifndef WHEEL_H
+#define WHEEL_H
+
+#include "types.h"
+
+/* Rueda de temporizadores con hash: cada temporizador cae en la ranura
+   (vencimiento % WHEEL_SLOTS) y queda en una lista doblemente enlazada, asi
+   que programar y cancelar son O(1). Avanzar un milisegundo solo revisa una
+   ranura; los temporizadores de mas de WHEEL_SLOTS ms simplemente se saltan
+   hasta la vuelta en que vencen. Un mapa de bits de ranuras ocupadas permite
+   saber cuanto se puede dormir hasta la siguiente */
+
+#define WHEEL_SLOTS  (256) // potencia de 2, en ms
+#define WHEEL_TIMERS (4096 + 512) // uno por enemigo y los demas eventos
+#define WHEEL_NONE   (0xFFFF)
+
+/* Identificador de un temporizador programado; 0 = ninguno. Lleva una
+   generacion para que cancelar un temporizador que ya vencio no haga nada */
+typedef u32 timer_id;
+
+typedef void (*timer_fn)(void *arg);
+
+struct wheel_timer{
+	u32 expires;	// ms absolutos
+	u16 prev, next;
+	u16 gen;
+	timer_fn fn;	// 0 si esta libre o ya vencio
+	void *arg;
+};
+
+struct wheel{
+	u32 now;	// ultimo ms procesado
+	u16 free;
+	u16 head[WHEEL_SLOTS];
+	u32 busy[WHEEL_SLOTS / 32];
+	struct wheel_timer t[WHEEL_TIMERS];
+};
+
+void wheel_init(struct wheel *w, u32 now);
+
+/* Cancela todos los temporizadores pendientes */
+void wheel_clear(struct wheel *w);
+
+/* Llama fn(arg) dentro de ms milisegundos (minimo 1). Retorna 0 si no quedan
+   temporizadores libres */
+timer_id wheel_schedule(struct wheel *w, u32 ms, timer_fn fn, void *arg);
+
+/* Retorna true si el temporizador seguia pendiente */
+bool wheel_cancel(struct wheel *w, timer_id id);
+
+/* Procesa cada ms hasta now llamando a los temporizadores que vencen */
+void wheel_advance(struct wheel *w, u32 now);
+
+/* Milisegundos hasta la siguiente ranura ocupada (WHEEL_SLOTS si no hay) */
+u32 wheel_next(const struct wheel *w);
+
+#endif